@@ -0,0 +1,97 @@
+/**
+ * Scaling of ParallelNdjsonReader over 1..N threads in both delivery modes.
+ *
+ *     ndjson_scaling [file] [size in MiB] [max threads]
+ *
+ * Writes a synthetic event log of the given size to file first if it does not exist yet (default: events.ndjson,
+ * 2048 MiB, all hardware threads). The file is memory mapped, so after the first run the timings are of parsing only.
+*/
+
+#include "../src/qjson.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+	void writeCorpus(const std::string& filename, const std::size_t bytes) {
+		std::ofstream file {filename, std::ios::binary};
+		if (!file) {
+			throw std::runtime_error("Can't create file: " + filename);
+		}
+
+		static const char* const types[] = {"click", "view", "purchase", "login", "logout"};
+
+		std::mt19937_64 random {42};
+		std::string line;
+		std::size_t written = 0;
+
+		for (std::uint64_t id = 0; written < bytes; ++id) {
+			line = "{\"id\":" + std::to_string(id);
+			line += ",\"type\":\"" + std::string(types[random() % 5]) + "\"";
+			line += ",\"user\":\"user_" + std::to_string(random() % 100000) + "\"";
+			line += ",\"price\":" + std::to_string(static_cast<double>(random() % 100000) / 100);
+			line += ",\"tags\":[\"a\",\"b\\\"c\",\"" + std::to_string(random() % 1000) + "\"]";
+			line += ",\"meta\":{\"ok\":" + std::string(random() % 2 ? "true" : "false") + ",\"ref\":null}}\n";
+
+			file.write(line.data(), static_cast<std::streamsize>(line.size()));
+			written += line.size();
+		}
+	}
+
+	bool exists(const std::string& filename) {
+		return std::ifstream(filename).good();
+	}
+}
+
+int main(int argc, char** argv) {
+	const std::string filename = argc > 1 ? argv[1] : "events.ndjson";
+	const std::size_t mib = argc > 2 ? std::stoul(argv[2]) : 2048;
+	const unsigned max_threads = argc > 3 ? static_cast<unsigned>(std::stoul(argv[3])) : std::max(std::thread::hardware_concurrency(), 1u);
+
+	if (!exists(filename)) {
+		std::printf("writing %zu MiB to %s\n", mib, filename.c_str());
+		writeCorpus(filename, mib * 1024 * 1024);
+	}
+
+	// powers of two, and max_threads itself
+	std::vector<unsigned> thread_counts;
+	for (unsigned threads = 1; threads < max_threads; threads *= 2) {
+		thread_counts.push_back(threads);
+	}
+	thread_counts.push_back(max_threads);
+
+	const double size = static_cast<double>(std::filesystem::file_size(filename)) / (1024 * 1024);
+
+	std::printf("%-10s %8s %10s %10s %9s\n", "delivery", "threads", "seconds", "MiB/s", "speed-up");
+
+	for (const qjson::Delivery delivery : {qjson::Delivery::ORDERED, qjson::Delivery::UNORDERED}) {
+		const char* const name = delivery == qjson::Delivery::ORDERED ? "ordered" : "unordered";
+		double single = 0;
+
+		for (const unsigned threads : thread_counts) {
+			qjson::ParallelNdjsonReader reader {filename, qjson::InputMode::MMAP, delivery, threads};
+
+			std::size_t records = 0;
+			double total = 0;
+
+			const auto start = std::chrono::steady_clock::now();
+			reader.forEach([&](const qjson::Json& record) {
+				records++;
+				total += record["price"].asDouble();
+			});
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			if (threads == 1) {
+				single = seconds;
+			}
+
+			std::printf("%-10s %8u %10.3f %10.1f %8.2fx   (%zu records, sum %.2f)\n", name, threads, seconds, size / seconds, single / seconds, records, total);
+		}
+	}
+
+	return 0;
+}
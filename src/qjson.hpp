@@ -1,452 +1,4143 @@
 #pragma once
 
+#include <algorithm>
 #include <iostream>
 #include <unordered_map>
 #include <vector>
 #include <fstream>
+#include <iterator>
+#include <optional>
 #include <memory>
 #include <string>
-#include <stack>
+#include <string_view>
+#include <span>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <limits>
+#include <bit>
 #include <stdexcept>
+#include <deque>
+#include <map>
+#include <exception>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdlib>
+
+#if defined(__unix__) || defined(__APPLE__)
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+	#define QJSON_HAS_MMAP 1
+#else
+	#define QJSON_HAS_MMAP 0
+#endif
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+	#include <emmintrin.h>
+#endif
+
+// without exceptions (-fno-exceptions) everything that would throw aborts, only the try* functions report errors
+#if defined(__cpp_exceptions)
+	#define QJSON_THROW(message) throw std::runtime_error(message)
+#else
+	#define QJSON_THROW(message) (static_cast<void>(message), std::abort())
+#endif
 
 /**
  * @namespace qjson
  * Very simple JSON parser that loads JSON files into a tree structure of shared ptrs.
 */
 namespace qjson {
-	enum struct JsonType {
+	// runs work and returns what it threw, so it can be rethrown on another thread
+	template <class Work>
+	std::exception_ptr captureException(Work&& work) {
+#if defined(__cpp_exceptions)
+		try {
+			work();
+		} catch (...) {
+			return std::current_exception();
+		}
+#else
+		work();
+#endif
+		return nullptr;
+	}
+
+	enum struct JsonType : std::uint8_t {
 		STRING,
+		INTEGER,
+		DOUBLE,
+		BOOLEAN,
+		NULL_VALUE,
 		OBJECT,
 		ARRAY,
 		UNINIT
 	};
 
-	class JsonData;
 	/**
-	 * @class ov_shared_ptr
-	 * This is a wrapper around std::shared_ptr that allows for easier access to the underlying object. This allows for
-	 * all data to be kept in shared ptrs but the user doesn't have to deal with the shared ptrs directly.
+	 * How Json reads a file. STREAM reads through std::ifstream in small chunks, MMAP maps the whole file and parses the
+	 * mapped bytes in place. MMAP falls back to STREAM on platforms without mmap.
+	*/
+	enum struct InputMode {
+		STREAM,
+		MMAP
+	};
+
+	class KeyDictionary;
+
+	/**
+	 * @struct ParseOptions
+	 * Optional behaviour of the parsers, all off by default.
+	*/
+	struct ParseOptions {
+		// reject input that is not well formed UTF-8, checked while indexing at the cost of a few percent
+		bool validate_utf8 = false;
+
+		/**
+		 * Json only: strings without escapes point into the input instead of being copied. Buffers passed in then have
+		 * to outlive the document, files are only read this way in MMAP mode and stay mapped for as long as the document
+		 * exists. Keys are interned (see keys) and copied once per distinct key.
+		*/
+		bool zero_copy = false;
+
+		/**
+		 * Json and IncrementalParser only, not Json::parallel: dictionary the keys of the document are interned into.
+		 * Documents given the same dictionary store each distinct key once between them. Unset, every document gets a
+		 * dictionary of its own.
+		*/
+		std::shared_ptr<KeyDictionary> keys;
+	};
+
+	/**
+	 * Why input was rejected. Each front end also throws for these, describe() gives the start of its message.
+	*/
+	enum struct ErrorCode {
+		NONE,
+		EMPTY,                    // no value at all
+		TRAILING_CONTENT,         // more after the value
+		EXPECTED_COLON,
+		EXPECTED_COMMA_OR_CLOSE,
+		EXPECTED_KEY,
+		UNEXPECTED_CHARACTER,
+		UNMATCHED_CLOSE,          // closing bracket without an open container
+		BRACKET_MISMATCH,         // ] closing { or } closing [
+		UNCLOSED_BRACKET,
+		UNCLOSED_STRING,
+		INVALID_NUMBER,
+		INVALID_LITERAL,
+		INVALID_ESCAPE,
+		CONTROL_CHARACTER,        // unescaped, inside a string
+		INVALID_UTF8              // only checked with ParseOptions::validate_utf8
+	};
+
+	inline const char* describe(const ErrorCode code) {
+		switch (code) {
+			case ErrorCode::NONE: return "No error";
+			case ErrorCode::EMPTY: return "No JSON value found";
+			case ErrorCode::TRAILING_CONTENT: return "Unexpected content after JSON value";
+			case ErrorCode::EXPECTED_COLON: return "Expected ':' after key";
+			case ErrorCode::EXPECTED_COMMA_OR_CLOSE: return "Expected ',' or closing bracket";
+			case ErrorCode::EXPECTED_KEY: return "Expected key";
+			case ErrorCode::UNEXPECTED_CHARACTER: return "Unexpected character";
+			case ErrorCode::UNMATCHED_CLOSE: return "Closing non existing bracket";
+			case ErrorCode::BRACKET_MISMATCH: return "Bracket type mismatch";
+			case ErrorCode::UNCLOSED_BRACKET: return "Bracket not closed";
+			case ErrorCode::UNCLOSED_STRING: return "String not closed";
+			case ErrorCode::INVALID_NUMBER: return "Invalid number";
+			case ErrorCode::INVALID_LITERAL: return "Invalid literal";
+			case ErrorCode::INVALID_ESCAPE: return "Invalid escape sequence";
+			case ErrorCode::CONTROL_CHARACTER: return "Unescaped control character in string";
+			case ErrorCode::INVALID_UTF8: return "Invalid UTF-8";
+		}
+
+		return "Unknown error";
+	}
+
+	/**
+	 * @struct ParseError
+	 * Result of the try* functions: what was wrong with the input and where. Converts to true if there was an error.
+	 * Errors are placed at the token at fault and invalid UTF-8 at its first bad byte, or at the end of the input if
+	 * something was left open.
+	*/
+	struct ParseError {
+		ErrorCode code = ErrorCode::NONE;
+		std::size_t offset = 0; // in bytes from the start of the input
+		std::size_t line = 0;   // from 1
+		std::size_t column = 0; // from 1, in bytes
+
+		explicit operator bool() const { return code != ErrorCode::NONE; }
+	};
+
+	// error at offset of the input data, with its line and column
+	inline ParseError locate(const ErrorCode code, const std::size_t offset, const char* data, const std::size_t length) {
+		const std::string_view before {data, std::min(offset, length)};
+		const std::size_t line_start = before.rfind('\n') + 1; // 0 if there is no newline
+		return {code, offset, 1 + static_cast<std::size_t>(std::count(before.begin(), before.end(), '\n')), offset - line_start + 1};
+	}
+
+	/**
+	 * @class ParseResult
+	 * Either a parsed value or the error that prevented it, in the manner of std::expected.
+	 *
+	 *     const auto result = qjson::Json::tryParse(body.data(), body.size());
+	 *     if (!result) {
+	 *         reject(result.error().line, result.error().column, qjson::describe(result.error().code));
+	 *     }
+	*/
+	template <class T> class ParseResult {
+		public:
+			ParseResult(T value) : value_(std::move(value)) {} // NOLINT (explicit)
+			ParseResult(const ParseError& error) : error_(error) {} // NOLINT (explicit)
+
+			[[nodiscard]] bool has_value() const { return value_.has_value(); }
+			explicit operator bool() const { return value_.has_value(); }
+
+			// only valid if there is a value
+			T& operator* () { return *value_; }
+			const T& operator* () const { return *value_; }
+			T* operator-> () { return &*value_; }
+			const T* operator-> () const { return &*value_; }
+
+			[[nodiscard]] const ParseError& error() const { return error_; }
+
+		private:
+			std::optional<T> value_;
+			ParseError error_;
+	};
+
+	/**
+	 * @class MappedFile
+	 * Read only memory mapping of a whole file, unmapped on destruction. The kernel is told the mapping will be read
+	 * sequentially (and may be backed by huge pages) since the parser walks it front to back exactly once.
+	*/
+	class MappedFile {
+		public:
+			static constexpr bool supported = QJSON_HAS_MMAP;
+
+			MappedFile() = default;
+
+			explicit MappedFile(const std::string& filename) {
+#if QJSON_HAS_MMAP
+				const int fd = ::open(filename.c_str(), O_RDONLY);
+				if (fd < 0) {
+					QJSON_THROW("Can't open file: " + filename);
+				}
+
+				struct stat info {};
+				if (::fstat(fd, &info) != 0) {
+					::close(fd);
+					QJSON_THROW("Can't read size of file: " + filename);
+				}
+
+				size_ = static_cast<std::size_t>(info.st_size);
+
+				if (size_ > 0) {
+					void* mapping = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+					if (mapping == MAP_FAILED) {
+						::close(fd);
+						QJSON_THROW("Can't map file: " + filename);
+					}
+
+					data_ = static_cast<const char*>(mapping);
+	#ifdef MADV_SEQUENTIAL
+					::madvise(mapping, size_, MADV_SEQUENTIAL);
+	#endif
+	#ifdef MADV_HUGEPAGE
+					::madvise(mapping, size_, MADV_HUGEPAGE);
+	#endif
+				}
+
+				::close(fd);
+#else
+				QJSON_THROW("Memory mapped files are not supported on this platform: " + filename);
+#endif
+			};
+
+			MappedFile(const MappedFile&) = delete;
+			MappedFile& operator= (const MappedFile&) = delete;
+
+			MappedFile(MappedFile&& other) noexcept
+				: data_ {other.data_},
+				  size_ {other.size_}
+			{
+				other.data_ = nullptr;
+				other.size_ = 0;
+			};
+
+			MappedFile& operator= (MappedFile&& other) noexcept {
+				if (this != &other) {
+					unmap();
+					data_ = other.data_;
+					size_ = other.size_;
+					other.data_ = nullptr;
+					other.size_ = 0;
+				}
+
+				return *this;
+			};
+
+			~MappedFile() { unmap(); };
+
+			[[nodiscard]] const char* data() const { return data_; };
+			[[nodiscard]] std::size_t size() const { return size_; };
+
+		private:
+			const char* data_ = nullptr;
+			std::size_t size_ = 0;
+
+			void unmap() {
+#if QJSON_HAS_MMAP
+				if (data_ != nullptr) {
+					::munmap(const_cast<char*>(data_), size_);
+				}
+#endif
+				data_ = nullptr;
+				size_ = 0;
+			};
+	};
+
+	/**
+	 * @struct BlockMasks
+	 * Stage 1 classification of a 64 byte block of input. Bit i of every mask describes byte i of the block.
+	*/
+	struct BlockMasks {
+		std::uint64_t quote = 0;
+		std::uint64_t backslash = 0;
+		std::uint64_t structural = 0; // { } [ ] : ,
+		std::uint64_t whitespace = 0;
+		std::uint64_t control = 0; // bytes below 0x20, only allowed escaped inside strings
+	};
+
+	inline constexpr std::size_t block_size = 64;
+
+#if defined(__AVX2__)
+	inline BlockMasks classifyBlock(const char* block) {
+		const auto matches = [](const __m256i lo, const __m256i hi) -> std::uint64_t {
+			return static_cast<std::uint32_t>(_mm256_movemask_epi8(lo))
+				| (static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(hi))) << 32);
+		};
+
+		const auto equals = [](const __m256i v, const char c) { return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)); };
+
+		const auto structural = [&equals](const __m256i v) {
+			// '[' and ']' differ from '{' and '}' only in bit 0x20
+			const __m256i folded = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+			return _mm256_or_si256(
+				_mm256_or_si256(equals(folded, '{'), equals(folded, '}')),
+				_mm256_or_si256(equals(v, ':'), equals(v, ','))
+			);
+		};
+
+		const auto whitespace = [&equals](const __m256i v) {
+			return _mm256_or_si256(
+				_mm256_or_si256(equals(v, ' '), equals(v, '\n')),
+				_mm256_or_si256(equals(v, '\t'), equals(v, '\r'))
+			);
+		};
+
+		// unsigned v <= 0x1f
+		const auto control = [](const __m256i v) {
+			return _mm256_cmpeq_epi8(_mm256_max_epu8(v, _mm256_set1_epi8(0x1f)), _mm256_set1_epi8(0x1f));
+		};
+
+		const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+		const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+
+		return {
+			matches(equals(lo, '"'), equals(hi, '"')),
+			matches(equals(lo, '\\'), equals(hi, '\\')),
+			matches(structural(lo), structural(hi)),
+			matches(whitespace(lo), whitespace(hi)),
+			matches(control(lo), control(hi))
+		};
+	}
+#elif defined(__SSE2__) || defined(_M_X64)
+	inline BlockMasks classifyBlock(const char* block) {
+		const auto equals = [](const __m128i v, const char c) { return _mm_cmpeq_epi8(v, _mm_set1_epi8(c)); };
+
+		BlockMasks masks;
+		for (int offset = 0; offset < 64; offset += 16) {
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + offset));
+			// '[' and ']' differ from '{' and '}' only in bit 0x20
+			const __m128i folded = _mm_or_si128(v, _mm_set1_epi8(0x20));
+
+			const __m128i structural = _mm_or_si128(
+				_mm_or_si128(equals(folded, '{'), equals(folded, '}')),
+				_mm_or_si128(equals(v, ':'), equals(v, ','))
+			);
+
+			const __m128i whitespace = _mm_or_si128(
+				_mm_or_si128(equals(v, ' '), equals(v, '\n')),
+				_mm_or_si128(equals(v, '\t'), equals(v, '\r'))
+			);
+
+			// unsigned v <= 0x1f
+			const __m128i control = _mm_cmpeq_epi8(_mm_max_epu8(v, _mm_set1_epi8(0x1f)), _mm_set1_epi8(0x1f));
+
+			const auto bits = [offset](const __m128i match) {
+				return static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(match))) << offset;
+			};
+
+			masks.quote |= bits(equals(v, '"'));
+			masks.backslash |= bits(equals(v, '\\'));
+			masks.structural |= bits(structural);
+			masks.whitespace |= bits(whitespace);
+			masks.control |= bits(control);
+		}
+
+		return masks;
+	}
+#else
+	/**
+	 * Portable fallback that classifies 8 bytes at a time in a 64 bit word (SWAR). Every comparison sets the high bit of
+	 * exactly the matching bytes, without carries from one byte into the next.
+	*/
+	inline BlockMasks classifyBlock(const char* block) {
+		constexpr std::uint64_t ones = 0x0101010101010101;
+		constexpr std::uint64_t high = 0x8080808080808080;
+		constexpr std::uint64_t low = 0x7f7f7f7f7f7f7f7f;
+
+		const auto equals = [](const std::uint64_t word, const char c) {
+			const std::uint64_t x = word ^ (ones * static_cast<unsigned char>(c));
+			return ~(((x & low) + low) | x) & high;
+		};
+
+		// bytes below 0x20: the high bit is clear and the low seven bits do not reach 0x20
+		const auto control = [](const std::uint64_t word) { return ~(((word & low) + ones * 0x60) | word) & high; };
+
+		// gathers the high bit of every byte into 8 consecutive bits
+		const auto bits = [](const std::uint64_t matches) { return ((matches >> 7) * 0x0102040810204080) >> 56; };
+
+		BlockMasks masks;
+		for (int offset = 0; offset < 64; offset += 8) {
+			// little endian load whatever the platform, byte i of the block ends up in byte i of the word
+			std::uint64_t word = 0;
+			for (int i = 7; i >= 0; i--) {
+				word = (word << 8) | static_cast<unsigned char>(block[offset + i]);
+			}
+
+			// '[' and ']' differ from '{' and '}' only in bit 0x20
+			const std::uint64_t folded = word | (ones * 0x20);
+
+			masks.quote |= bits(equals(word, '"')) << offset;
+			masks.backslash |= bits(equals(word, '\\')) << offset;
+			masks.structural |= bits(equals(folded, '{') | equals(folded, '}') | equals(word, ':') | equals(word, ',')) << offset;
+			masks.whitespace |= bits(equals(word, ' ') | equals(word, '\n') | equals(word, '\t') | equals(word, '\r')) << offset;
+			masks.control |= bits(control(word)) << offset;
+		}
+
+		return masks;
+	}
+#endif
+
+	/**
+	 * Turns a mask of quote positions into a mask that is set from every opening quote up to (not including) the
+	 * matching closing quote.
+	*/
+	inline std::uint64_t prefixXor(std::uint64_t bits) {
+		bits ^= bits << 1;
+		bits ^= bits << 2;
+		bits ^= bits << 4;
+		bits ^= bits << 8;
+		bits ^= bits << 16;
+		bits ^= bits << 32;
+		return bits;
+	}
+
+	/**
+	 * Marks the characters escaped by a backslash, i.e. the one after every run of backslashes of odd length (an escaped
+	 * backslash is marked too). escape_carry is 1 when the last backslash of the block escapes the first character of
+	 * the next one, it is updated for the next call.
+	*/
+	inline std::uint64_t escapedChars(std::uint64_t backslash, std::uint64_t& escape_carry) {
+		constexpr std::uint64_t even_bits = 0x5555555555555555;
+
+		backslash &= ~escape_carry;
+		const std::uint64_t follows_escape = (backslash << 1) | escape_carry;
+
+		// adding the runs that start on odd bits to the backslashes makes every such run carry out at its end
+		const std::uint64_t odd_starts = backslash & ~even_bits & ~follows_escape;
+		const std::uint64_t sequences_on_even = odd_starts + backslash;
+		escape_carry = sequences_on_even < odd_starts;
+
+		return (even_bits ^ (sequences_on_even << 1)) & follows_escape;
+	}
+
+	// scalar (per character) versions of the classes computed by classifyBlock
+	inline bool isStructural(const char c) { return c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ','; }
+	inline bool isWhitespace(const char c) { return c == ' ' || c == '\n' || c == '\t' || c == '\r'; }
+	inline bool isScalarPart(const char c) { return !isStructural(c) && !isWhitespace(c) && c != '"'; }
+
+	/**
+	 * @class Utf8Validator
+	 * Checks that input is well formed UTF-8 (no overlong forms, surrogates or code points above U+10FFFF), one block
+	 * of up to 64 bytes at a time so it can run alongside the structural indexer. With AVX2 this is the lookup table
+	 * algorithm of Keiser and Lemire, elsewhere a byte at a time state machine. Blocks made only of ASCII are skipped
+	 * in both. State carries over from block to block, so input can be checked in pieces.
+	*/
+	class Utf8Validator {
+		public:
+			/**
+			 * Checks the first length bytes of a block. All 64 bytes must be readable, the ones past length are
+			 * ignored.
+			*/
+			void check(const char* block, const std::size_t length) {
+#if defined(__AVX2__)
+				before_ = previous_;
+
+				const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+				const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+
+				if (length == block_size) {
+					if (_mm256_movemask_epi8(_mm256_or_si256(lo, hi)) == 0) {
+						error_ = _mm256_or_si256(error_, incomplete_);
+						return;
+					}
+
+					error_ = _mm256_or_si256(error_, errors(lo, previous_));
+					error_ = _mm256_or_si256(error_, errors(hi, lo));
+					previous_ = hi;
+					incomplete_ = isIncomplete(hi);
+					return;
+				}
+
+				// padding is not input: errors found there do not count, and the next block continues the real bytes
+				const auto real = [length](const __m256i errors, const std::size_t offset) -> std::uint32_t {
+					const auto clean = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(errors, _mm256_setzero_si256())));
+					const std::size_t count = length > offset ? std::min<std::size_t>(length - offset, 32) : 0;
+					return ~clean & static_cast<std::uint32_t>((std::uint64_t {1} << count) - 1);
+				};
+
+				failed_ = failed_ || real(errors(lo, previous_), 0) != 0 || real(errors(hi, lo), 32) != 0;
+
+				alignas(32) char last[32 + block_size];
+				_mm256_store_si256(reinterpret_cast<__m256i*>(last), previous_);
+				std::memcpy(last + 32, block, length);
+				previous_ = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(last + length));
+				incomplete_ = isIncomplete(previous_);
+#else
+				before_ = sequence_;
+
+				for (std::size_t i = 0; i < length; i++) {
+					// skip ahead over ASCII eight bytes at a time
+					std::uint64_t word;
+					while (sequence_.pending == 0 && i + sizeof(word) <= length) {
+						std::memcpy(&word, block + i, sizeof(word));
+						if ((word & 0x8080808080808080) != 0) {
+							break;
+						}
+
+						i += sizeof(word);
+					}
+
+					if (i == length) {
+						break;
+					}
+
+					if (!sequence_.accept(static_cast<unsigned char>(block[i]))) {
+						failed_ = true;
+					}
+				}
+#endif
+			};
+
+			// true once invalid input was seen
+			[[nodiscard]] bool failed() const {
+#if defined(__AVX2__)
+				return failed_ || !_mm256_testz_si256(error_, error_);
+#else
+				return failed_;
+#endif
+			};
+
+			// true if the input checked so far ends inside a character
+			[[nodiscard]] bool incomplete() const {
+#if defined(__AVX2__)
+				return !_mm256_testz_si256(incomplete_, incomplete_);
+#else
+				return sequence_.pending != 0;
+#endif
+			};
+
+			/**
+			 * Index of the first invalid byte of the block checked last, once failed(). Goes over the block again a byte
+			 * at a time, so it is only meant for reporting errors. With AVX2 a bad lead byte is only noticed together with
+			 * the byte after it, so the index is negative for one in the last three bytes before the block.
+			*/
+			[[nodiscard]] std::ptrdiff_t locate(const char* block, const std::size_t length) const {
+#if defined(__AVX2__)
+				// only a character started in the last three bytes before the block can reach into it
+				alignas(32) unsigned char last[32];
+				_mm256_store_si256(reinterpret_cast<__m256i*>(last), before_);
+
+				// continuation bytes without a lead byte were reported before, only invalid lead bytes are not
+				Sequence sequence;
+				for (std::ptrdiff_t i = -3; i < 0; i++) {
+					if (!sequence.accept(last[32 + i]) && last[32 + i] >= 0xc0) {
+						return i;
+					}
+				}
+#else
+				Sequence sequence = before_;
+#endif
+				for (std::size_t i = 0; i < length; i++) {
+					if (!sequence.accept(static_cast<unsigned char>(block[i]))) {
+						return static_cast<std::ptrdiff_t>(i);
+					}
+				}
+
+				return static_cast<std::ptrdiff_t>(length);
+			};
+
+			void reset() { *this = Utf8Validator(); };
+
+		private:
+			/**
+			 * Byte at a time state machine: the lead byte tells how many continuation bytes follow and narrows the range
+			 * of the first one.
+			*/
+			struct Sequence {
+				int pending = 0; // continuation bytes still expected
+				unsigned char low = 0x80; // range of the next continuation byte
+				unsigned char high = 0xbf;
+
+				// false if byte can not follow the bytes accepted so far, the state then continues as if it was ASCII
+				bool accept(const unsigned char byte) {
+					if (pending != 0) {
+						const bool valid = byte >= low && byte <= high;
+
+						pending = valid ? pending - 1 : 0;
+						low = 0x80;
+						high = 0xbf;
+
+						return valid;
+					}
+
+					if (byte < 0x80) {
+						return true;
+					}
+
+					if (byte >= 0xc2 && byte <= 0xdf) {
+						pending = 1;
+					} else if (byte >= 0xe0 && byte <= 0xef) {
+						pending = 2;
+						low = byte == 0xe0 ? 0xa0 : 0x80;
+						high = byte == 0xed ? 0x9f : 0xbf;
+					} else if (byte >= 0xf0 && byte <= 0xf4) {
+						pending = 3;
+						low = byte == 0xf0 ? 0x90 : 0x80;
+						high = byte == 0xf4 ? 0x8f : 0xbf;
+					} else {
+						return false;
+					}
+
+					return true;
+				}
+			};
+
+			bool failed_ = false;
+
+#if defined(__AVX2__)
+			__m256i error_ = _mm256_setzero_si256();
+			__m256i previous_ = _mm256_setzero_si256(); // only its last three bytes matter
+			__m256i incomplete_ = _mm256_setzero_si256();
+			__m256i before_ = _mm256_setzero_si256(); // previous_ as it was before the block checked last
+
+			// error flags, set when a pair of bytes (and the byte before them) breaks one of the rules
+			static constexpr std::uint8_t too_short = 1 << 0;      // lead byte not followed by enough continuations
+			static constexpr std::uint8_t too_long = 1 << 1;       // continuation byte after ASCII
+			static constexpr std::uint8_t overlong_3 = 1 << 2;
+			static constexpr std::uint8_t too_large = 1 << 3;
+			static constexpr std::uint8_t surrogate = 1 << 4;
+			static constexpr std::uint8_t overlong_2 = 1 << 5;
+			static constexpr std::uint8_t too_large_1000 = 1 << 6;
+			static constexpr std::uint8_t overlong_4 = 1 << 6;
+			static constexpr std::uint8_t two_continuations = 1 << 7;
+			static constexpr std::uint8_t carry = too_short | too_long | two_continuations;
+
+			// the vector made of the last count bytes of previous followed by the first 32 - count bytes of input
+			template <int count> static __m256i prev(const __m256i input, const __m256i previous) {
+				return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(previous, input, 0x21), 16 - count);
+			}
+
+			static __m256i lookup(const __m256i index, const __m256i table) { return _mm256_shuffle_epi8(table, index); }
+
+			static __m256i table(
+				const std::uint8_t v0, const std::uint8_t v1, const std::uint8_t v2, const std::uint8_t v3,
+				const std::uint8_t v4, const std::uint8_t v5, const std::uint8_t v6, const std::uint8_t v7,
+				const std::uint8_t v8, const std::uint8_t v9, const std::uint8_t v10, const std::uint8_t v11,
+				const std::uint8_t v12, const std::uint8_t v13, const std::uint8_t v14, const std::uint8_t v15
+			) {
+				return _mm256_setr_epi8(
+					v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, v15,
+					v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, v15
+				);
+			}
+
+			static __m256i high_nibble(const __m256i v) { return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0f)); }
+
+			static __m256i errors(const __m256i input, const __m256i previous) {
+				const __m256i prev1 = prev<1>(input, previous);
+
+				const __m256i byte_1_high = lookup(high_nibble(prev1), table(
+					too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long,
+					two_continuations, two_continuations, two_continuations, two_continuations,
+					too_short | overlong_2,
+					too_short,
+					too_short | overlong_3 | surrogate,
+					too_short | too_large | too_large_1000 | overlong_4
+				));
+
+				const __m256i byte_1_low = lookup(_mm256_and_si256(prev1, _mm256_set1_epi8(0x0f)), table(
+					carry | overlong_3 | overlong_2 | overlong_4,
+					carry | overlong_2,
+					carry,
+					carry,
+					carry | too_large,
+					carry | too_large | too_large_1000,
+					carry | too_large | too_large_1000,
+					carry | too_large | too_large_1000,
+					carry | too_large | too_large_1000,
+					carry | too_large | too_large_1000,
+					carry | too_large | too_large_1000,
+					carry | too_large | too_large_1000,
+					carry | too_large | too_large_1000,
+					carry | too_large | too_large_1000 | surrogate,
+					carry | too_large | too_large_1000,
+					carry | too_large | too_large_1000
+				));
+
+				const __m256i byte_2_high = lookup(high_nibble(input), table(
+					too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short,
+					too_long | overlong_2 | two_continuations | overlong_3 | too_large_1000 | overlong_4,
+					too_long | overlong_2 | two_continuations | overlong_3 | too_large,
+					too_long | overlong_2 | two_continuations | surrogate | too_large,
+					too_long | overlong_2 | two_continuations | surrogate | too_large,
+					too_short, too_short, too_short, too_short
+				));
+
+				const __m256i special = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+				// the third and fourth byte of a character must be continuations, two_continuations flags exactly those
+				const __m256i third = _mm256_subs_epu8(prev<2>(input, previous), _mm256_set1_epi8(static_cast<char>(0xe0 - 0x80)));
+				const __m256i fourth = _mm256_subs_epu8(prev<3>(input, previous), _mm256_set1_epi8(static_cast<char>(0xf0 - 0x80)));
+				const __m256i must_be_continuation = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(static_cast<char>(0x80)));
+
+				return _mm256_xor_si256(must_be_continuation, special);
+			}
+
+			// non zero if the last bytes of input start a character that is not finished
+			static __m256i isIncomplete(const __m256i input) {
+				const __m256i max = _mm256_setr_epi8(
+					-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+					-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+					static_cast<char>(0xf0 - 1), static_cast<char>(0xe0 - 1), static_cast<char>(0xc0 - 1)
+				);
+
+				return _mm256_subs_epu8(input, max);
+			}
+#else
+			Sequence sequence_;
+			Sequence before_; // sequence_ as it was before the block checked last
+#endif
+	};
+
+	/**
+	 * @class StructuralIndexer
+	 * Stage 1 of parsing. Classifies input 64 bytes at a time and records the position of every quote, every
+	 * structural character outside of strings and the first character of every number or literal. Quotes escaped with a
+	 * backslash are not recorded, control characters inside strings are rejected on the way. Whether the input ends
+	 * inside a string or an escape is carried over to the next call so input can be indexed in pieces.
+	*/
+	class StructuralIndexer {
+		public:
+			explicit StructuralIndexer(const ParseOptions& options = {}) : validate_utf8_(options.validate_utf8) {}
+
+			/**
+			 * Returns false at the first block with a control character in a string or invalid UTF-8, the positions
+			 * before that block are recorded. error() and errorOffset() (counted from data) tell why and at which byte,
+			 * invalid UTF-8 can start up to three bytes before data.
+			*/
+			bool index(const char* data, const std::size_t length, std::vector<std::uint32_t>& positions) {
+				positions.clear();
+				std::uint64_t previous_scalar = 0;
+
+				for (std::size_t offset = 0; offset < length; offset += block_size) {
+					const std::size_t remaining = length - offset;
+					const char* block = data + offset;
+
+					char padded[block_size];
+					if (remaining < block_size) {
+						std::memset(padded, ' ', block_size);
+						std::memcpy(padded, block, remaining);
+						block = padded;
+					}
+
+					BlockMasks masks = classifyBlock(block);
+					if (validate_utf8_) {
+						utf8_.check(block, std::min(remaining, block_size));
+						if (utf8_.failed()) {
+							const std::ptrdiff_t bad = utf8_.locate(block, std::min(remaining, block_size));
+							return fail(ErrorCode::INVALID_UTF8, static_cast<std::ptrdiff_t>(offset) + bad);
+						}
+					}
+
+					// escaped quotes neither open nor close a string
+					const std::uint64_t escaped = escapedChars(masks.backslash, escape_carry_);
+					masks.quote &= ~escaped;
+					if (remaining < block_size) {
+						// the padding is not input, whether its first byte is escaped is what carries over
+						escape_carry_ = (escaped >> remaining) & 1;
+					}
+
+					const std::uint64_t in_string = prefixXor(masks.quote) ^ in_string_;
+					in_string_ = std::uint64_t {0} - (in_string >> 63);
+
+					if ((masks.control & in_string) != 0) {
+						return fail(ErrorCode::CONTROL_CHARACTER, offset + std::countr_zero(masks.control & in_string));
+					}
+
+					const std::uint64_t scalar = ~(masks.structural | masks.whitespace | masks.quote | in_string);
+					const std::uint64_t scalar_start = scalar & ~((scalar << 1) | previous_scalar);
+					previous_scalar = scalar >> 63;
+
+					std::uint64_t interesting = masks.quote | (masks.structural & ~in_string) | scalar_start;
+					if (remaining < block_size) {
+						interesting &= (std::uint64_t {1} << remaining) - 1;
+					}
+
+					while (interesting != 0) {
+						positions.push_back(static_cast<std::uint32_t>(offset + std::countr_zero(interesting)));
+						interesting &= interesting - 1;
+					}
+				}
+
+				return true;
+			};
+
+			// call once all input was indexed, false if it ends inside a UTF-8 character
+			[[nodiscard]] bool finish() const {
+				return !validate_utf8_ || !utf8_.incomplete();
+			};
+
+			[[nodiscard]] ErrorCode error() const { return error_; };
+			[[nodiscard]] std::ptrdiff_t errorOffset() const { return error_offset_; };
+
+			void reset() {
+				in_string_ = 0;
+				escape_carry_ = 0;
+				utf8_.reset();
+				error_ = ErrorCode::NONE;
+			};
+
+		private:
+			bool validate_utf8_;
+			Utf8Validator utf8_;
+
+			ErrorCode error_ = ErrorCode::NONE;
+			std::ptrdiff_t error_offset_ = 0;
+
+			bool fail(const ErrorCode code, const std::ptrdiff_t offset) {
+				error_ = code;
+				error_offset_ = offset;
+				return false;
+			};
+
+			std::uint64_t in_string_ = 0; // all bits set while inside a string
+			std::uint64_t escape_carry_ = 0; // the first character of the next call is escaped
+	};
+
+	/**
+	 * @class Arena
+	 * Bump allocator that owns every node of one parsed document. Memory is handed out from a few large blocks and is
+	 * only given back when the arena is destroyed, all at once. Destructors of objects created here never run, so only
+	 * objects that own nothing but arena memory may be placed in it.
+	*/
+	class Arena {
+		public:
+			Arena() = default;
+
+			Arena(const Arena&) = delete;
+			Arena& operator= (const Arena&) = delete;
+
+			void* allocate(const std::size_t bytes, const std::size_t alignment) {
+				std::size_t padding = (0 - reinterpret_cast<std::uintptr_t>(cursor_)) & (alignment - 1);
+
+				if (static_cast<std::size_t>(end_ - cursor_) < padding + bytes) {
+					addBlock(bytes + alignment);
+					padding = (0 - reinterpret_cast<std::uintptr_t>(cursor_)) & (alignment - 1);
+				}
+
+				std::byte* const result = cursor_ + padding;
+				cursor_ = result + bytes;
+				return result;
+			};
+
+			template <class T, class... Args> T* create(Args&&... args) {
+				return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+			};
+
+			std::string_view copyString(const std::string_view text) {
+				if (text.empty()) {
+					return {};
+				}
+
+				char* const copy = static_cast<char*>(allocate(text.size(), 1));
+				std::memcpy(copy, text.data(), text.size());
+				return {copy, text.size()};
+			};
+
+			/**
+			 * Forgets everything allocated so far. The largest block is kept for reuse and the others are freed, so an
+			 * arena that is reset between documents stops allocating once it has seen the largest one.
+			*/
+			void reset() {
+				if (blocks_.empty()) {
+					return;
+				}
+
+				const auto largest = std::max_element(blocks_.begin(), blocks_.end(), [](const Block& a, const Block& b) {
+					return a.size < b.size;
+				});
+
+				Block kept = std::move(*largest);
+				blocks_.clear();
+				blocks_.push_back(std::move(kept));
+
+				cursor_ = blocks_.back().memory.get();
+				end_ = cursor_ + blocks_.back().size;
+			};
+
+			[[nodiscard]] std::size_t blockCount() const { return blocks_.size(); };
+
+		private:
+			static constexpr std::size_t first_block_size_ = 16 * 1024;
+			static constexpr std::size_t max_block_size_ = 64 * 1024 * 1024;
+
+			struct Block {
+				std::unique_ptr<std::byte[]> memory;
+				std::size_t size;
+			};
+
+			std::vector<Block> blocks_;
+			std::byte* cursor_ = nullptr;
+			std::byte* end_ = nullptr;
+			std::size_t next_block_size_ = first_block_size_;
+
+			void addBlock(const std::size_t minimum_size) {
+				const std::size_t size = std::max(next_block_size_, minimum_size);
+				blocks_.push_back({std::unique_ptr<std::byte[]>(new std::byte[size]), size});
+				cursor_ = blocks_.back().memory.get();
+				end_ = cursor_ + size;
+				next_block_size_ = std::min(next_block_size_ * 2, max_block_size_);
+			};
+	};
+
+	/**
+	 * @class ArenaAllocator
+	 * Standard library allocator handing out arena memory, so containers inside the tree live in the same blocks as the
+	 * nodes. Deallocation is a no-op, the memory goes away with the arena.
+	*/
+	template <class T> class ArenaAllocator {
+		public:
+			using value_type = T;
+
+			explicit ArenaAllocator(Arena& arena) noexcept : arena_(&arena) {}
+			template <class U> ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_(other.arena_) {} // NOLINT (explicit)
+
+			T* allocate(const std::size_t count) { return static_cast<T*>(arena_->allocate(count * sizeof(T), alignof(T))); }
+			void deallocate(T*, std::size_t) noexcept {}
+
+			template <class U> bool operator== (const ArenaAllocator<U>& other) const { return arena_ == other.arena_; }
+			template <class U> bool operator!= (const ArenaAllocator<U>& other) const { return arena_ != other.arena_; }
+
+			Arena* arena_;
+	};
+
+	class JsonData;
+
+	using JsonArray = std::vector<JsonData*, ArenaAllocator<JsonData*>>;
+
+	/**
+	 * @struct Key
+	 * An interned object key. Every distinct key is stored once in a KeyDictionary together with its hash, objects
+	 * only hold pointers to it, so two interned keys are equal exactly when they are the same pointer.
+	*/
+	struct Key {
+		std::string_view text;
+		std::size_t hash;
+	};
+
+	/**
+	 * @class Shape
+	 * The keys of an object in member order, its hidden class. Objects with the same keys in the same order share one
+	 * shape and only store their values, in a dense array indexed by the slots of the shape. Shared shapes never change
+	 * and belong to a KeyDictionary. Objects with too many keys for their shape to be worth sharing, and objects whose
+	 * keys a full dictionary has no shape for, get one of their own.
+	 *
+	 * Most objects have a handful of keys, for those a slot is found by comparing the key pointers one after another.
+	 * Only shapes with more keys than that build an index, a flat open addressing table of slot numbers.
+	*/
+	class Shape {
+		public:
+			static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+			// empty shape with room for capacity keys
+			Shape(Arena& arena, const std::size_t capacity, const bool shared)
+				: keys_(static_cast<const Key**>(arena.allocate(capacity * sizeof(const Key*), alignof(const Key*)))),
+				  shared_(shared)
+			{};
+
+			// the keys of parent followed by key
+			Shape(Arena& arena, const Shape& parent, const Key* key)
+				: keys_(static_cast<const Key**>(arena.allocate((parent.size_ + 1) * sizeof(const Key*), alignof(const Key*)))),
+				  size_(parent.size_),
+				  shared_(true)
+			{
+				std::copy(parent.keys_, parent.keys_ + parent.size_, keys_);
+				append(arena, key);
+			};
+
+			[[nodiscard]] std::size_t size() const { return size_; };
+			[[nodiscard]] bool shared() const { return shared_; };
+			[[nodiscard]] const Key* key(const std::size_t slot) const { return keys_[slot]; };
+
+			[[nodiscard]] std::size_t slotOf(const Key* key) const {
+				if (index_ != nullptr) {
+					for (std::size_t i = key->hash & index_mask_; index_[i] != 0; i = (i + 1) & index_mask_) {
+						if (keys_[index_[i] - 1] == key) {
+							return index_[i] - 1;
+						}
+					}
+
+					return npos;
+				}
+
+				for (std::size_t slot = 0; slot < size_; ++slot) {
+					if (keys_[slot] == key) {
+						return slot;
+					}
+				}
+
+				return npos;
+			};
+
+			// adds key in the next slot, false if the shape has it already
+			bool append(Arena& arena, const Key* key) {
+				if (slotOf(key) != npos) {
+					return false;
+				}
+
+				keys_[size_++] = key;
+
+				if (index_ != nullptr && size_ * 2 <= index_mask_ + 1) {
+					insert(size_ - 1);
+				} else if (size_ > max_scanned_keys_) {
+					index_mask_ = std::bit_ceil(size_ * 2) - 1;
+					index_ = static_cast<std::uint32_t*>(arena.allocate((index_mask_ + 1) * sizeof(std::uint32_t), alignof(std::uint32_t)));
+					reindex();
+				}
+
+				return true;
+			};
+
+			// only for shapes that are not shared, the keys after slot move down and keep their order
+			void erase(const std::size_t slot) {
+				std::copy(keys_ + slot + 1, keys_ + size_, keys_ + slot);
+				--size_;
+
+				if (index_ != nullptr) {
+					reindex();
+				}
+			};
+
+		private:
+			friend class KeyDictionary;
+
+			// scanning this many pointers is as quick as hashing one and probing
+			static constexpr std::size_t max_scanned_keys_ = 8;
+
+			const Key** keys_;
+			std::size_t size_ = 0;
+
+			// open addressing with linear probing, entries are slot + 1 and 0 is empty, at most half of them are used
+			std::uint32_t* index_ = nullptr;
+			std::size_t index_mask_ = 0;
+
+			bool shared_;
+
+			// the last transition taken from this shape, objects of one array almost always take the same
+			const Key* next_key_ = nullptr;
+			Shape* next_shape_ = nullptr;
+
+			void insert(const std::size_t slot) {
+				std::size_t i = keys_[slot]->hash & index_mask_;
+				while (index_[i] != 0) {
+					i = (i + 1) & index_mask_;
+				}
+
+				index_[i] = static_cast<std::uint32_t>(slot + 1);
+			};
+
+			void reindex() {
+				std::fill(index_, index_ + index_mask_ + 1, 0);
+				for (std::size_t slot = 0; slot < size_; ++slot) {
+					insert(slot);
+				}
+			};
+	};
+
+	/**
+	 * @class KeyDictionary
+	 * Distinct keys of one or more documents, and the shapes of their objects. Key texts are copied into an arena of the
+	 * dictionary's own, so a dictionary can be shared between documents and outlive the input of any of them. Not
+	 * synchronised, documents sharing one must not be parsed concurrently.
+	*/
+	class KeyDictionary {
+		public:
+			KeyDictionary() = default;
+
+			KeyDictionary(const KeyDictionary&) = delete;
+			KeyDictionary& operator= (const KeyDictionary&) = delete;
+
+			const Key* intern(const std::string_view text) {
+				const auto found = keys_.find(text);
+				if (found != keys_.end()) {
+					return found->second;
+				}
+
+				const std::string_view copy = arena_.copyString(text);
+				const Key* const key = arena_.create<Key>(Key {copy, std::hash<std::string_view>()(copy)});
+				keys_.emplace(copy, key);
+				return key;
+			};
+
+			// nullptr for text that was never interned, no object can have such a key
+			[[nodiscard]] const Key* find(const std::string_view text) const {
+				const auto found = keys_.find(text);
+				return found == keys_.end() ? nullptr : found->second;
+			};
+
+			[[nodiscard]] std::size_t size() const { return keys_.size(); };
+
+			// forgets every key and shape, only safe once no object refers to them any more
+			void clear() {
+				keys_.clear();
+				transitions_.clear();
+				arena_.reset();
+				root_ = arena_.create<Shape>(arena_, 0, true);
+			};
+
+			// shape of objects without keys, all shared shapes are reached from it one key at a time
+			Shape* root() { return root_; };
+
+			/**
+			 * Shape of the keys of shape followed by key, shape itself if it has key already. nullptr once the dictionary
+			 * is full and has no such shape yet, objects with keys in ever new combinations would otherwise leave a
+			 * shape behind for every prefix of their keys.
+			*/
+			Shape* extend(Shape* shape, const Key* key) {
+				if (shape->next_key_ == key) {
+					return shape->next_shape_;
+				}
+
+				auto found = transitions_.find({shape, key});
+				if (found == transitions_.end()) {
+					if (transitions_.size() >= max_shapes_) {
+						return nullptr;
+					}
+
+					Shape* const next = shape->slotOf(key) != Shape::npos ? shape : arena_.create<Shape>(arena_, *shape, key);
+					found = transitions_.emplace(std::make_pair(shape, key), next).first;
+				}
+
+				shape->next_key_ = key;
+				shape->next_shape_ = found->second;
+				return found->second;
+			};
+
+			// a copy of shape that its object can change
+			Shape* unshare(const Shape& shape) {
+				Shape* const copy = arena_.create<Shape>(arena_, shape.size(), false);
+				for (std::size_t slot = 0; slot < shape.size(); ++slot) {
+					copy->append(arena_, shape.key(slot));
+				}
+
+				return copy;
+			};
+
+		private:
+			struct TransitionHash {
+				std::size_t operator() (const std::pair<const Shape*, const Key*>& transition) const {
+					return std::hash<const Shape*>()(transition.first) * 31 + transition.second->hash;
+				}
+			};
+
+			static constexpr std::size_t max_shapes_ = 64 * 1024;
+
+			Arena arena_;
+			std::unordered_map<std::string_view, const Key*> keys_;
+			Shape* root_ = arena_.create<Shape>(arena_, 0, true);
+			std::unordered_map<std::pair<const Shape*, const Key*>, Shape*, TransitionHash> transitions_;
+	};
+
+	/**
+	 * @class JsonObject
+	 * Members of an object: a shape holding the keys and a dense array with a value per slot of the shape. Iterating
+	 * visits the members in the order of the input. Looking a key up resolves its text in the dictionary once, the shape
+	 * then only compares key pointers.
+	*/
+	class JsonObject {
+		public:
+			using value_type = std::pair<const Key*, JsonData*>;
+
+			class iterator {
+				public:
+					using iterator_category = std::forward_iterator_tag;
+					using value_type = JsonObject::value_type;
+					using difference_type = std::ptrdiff_t;
+					using pointer = void;
+					using reference = value_type;
+
+					// members are made on the fly, -> has to hand out a copy
+					struct Arrow {
+						value_type member;
+						const value_type* operator-> () const { return &member; }
+					};
+
+					iterator() = default;
+					iterator(const JsonObject* object, const std::size_t slot) : object_(object), slot_(slot) {}
+
+					value_type operator* () const { return {object_->shape_->key(slot_), object_->values_[slot_]}; }
+					Arrow operator-> () const { return {**this}; }
+
+					iterator& operator++ () {
+						++slot_;
+						return *this;
+					}
+
+					iterator operator++ (int) {
+						iterator previous = *this;
+						++slot_;
+						return previous;
+					}
+
+					bool operator== (const iterator& other) const { return slot_ == other.slot_ && object_ == other.object_; }
+
+					[[nodiscard]] std::size_t slot() const { return slot_; }
+
+				private:
+					const JsonObject* object_ = nullptr;
+					std::size_t slot_ = 0;
+			};
+
+			using const_iterator = iterator;
+
+			JsonObject(KeyDictionary& keys, Shape* shape, JsonData** values) : keys_(&keys), shape_(shape), values_(values) {};
+
+			[[nodiscard]] iterator find(const std::string_view key) const {
+				const Key* const interned = keys_->find(key);
+				const std::size_t slot = interned == nullptr ? Shape::npos : shape_->slotOf(interned);
+				return {this, slot == Shape::npos ? shape_->size() : slot};
+			};
+
+			// later members move down a slot and the object takes the shape of its remaining keys
+			void erase(const iterator position) {
+				const std::size_t slot = position.slot();
+				const std::size_t size = shape_->size();
+
+				if (shape_->shared()) {
+					Shape* reshaped = keys_->root();
+					for (std::size_t i = 0; i < size && reshaped != nullptr; ++i) {
+						if (i != slot) {
+							reshaped = keys_->extend(reshaped, shape_->key(i));
+						}
+					}
+
+					if (reshaped != nullptr) {
+						shape_ = reshaped;
+					} else {
+						shape_ = keys_->unshare(*shape_);
+						shape_->erase(slot);
+					}
+				} else {
+					shape_->erase(slot);
+				}
+
+				std::copy(values_ + slot + 1, values_ + size, values_ + slot);
+			};
+
+			[[nodiscard]] iterator begin() const { return {this, 0}; };
+			[[nodiscard]] iterator end() const { return {this, shape_->size()}; };
+
+			[[nodiscard]] std::size_t size() const { return shape_->size(); };
+			[[nodiscard]] bool empty() const { return shape_->size() == 0; };
+			[[nodiscard]] const Shape& shape() const { return *shape_; };
+
+		private:
+			KeyDictionary* keys_;
+			Shape* shape_;
+			JsonData** values_;
+	};
+
+	/**
+	 * @class Document
+	 * Owns the arena every node of one parse lives in (and, with zero copy, the input), and the root of the tree.
+	 * Handles into the tree share ownership of the document, so it lives as long as any of them.
+	*/
+	class Document {
+		public:
+			Arena arena_;
+			JsonData* root_ = nullptr;
+			// keys of all objects in the tree, possibly shared with other documents
+			std::shared_ptr<KeyDictionary> keys_ = std::make_shared<KeyDictionary>();
+			// documents parsed on other threads whose nodes were linked into this one
+			std::vector<std::shared_ptr<Document>> parts_;
+			// mapped input the strings of the tree point into (zero copy)
+			MappedFile source_;
+	};
+
+	/**
+	 * @class ov_shared_ptr
+	 * This is a wrapper around std::shared_ptr that allows for easier access to the underlying object. This allows for
+	 * all data to be kept in shared ptrs but the user doesn't have to deal with the shared ptrs directly. Nodes of a
+	 * parsed document are not allocated one by one, handles to them share ownership of the whole document instead.
+	*/
+	template <class T> class ov_shared_ptr {
+		public:
+			ov_shared_ptr() : ptr_(std::make_shared<T>()) {}
+			explicit ov_shared_ptr(JsonType type) : ptr_(std::make_shared<T>()) { ptr_->type_ = type; }
+			explicit ov_shared_ptr(const std::shared_ptr<T>& ptr) : ptr_(ptr) {}
+			ov_shared_ptr(std::nullptr_t ptr) : ptr_(nullptr) {} // NOLINT (explicit)
+
+			void del(const std::string& key) {
+				if (ptr_ == nullptr) {
+					QJSON_THROW("Can't delete key on null pointer. Key: " + key);
+				}
+
+				if (ptr_->type_ != JsonType::OBJECT) {
+					QJSON_THROW("Can't delete key on non-object. Key: " + key);
+				}
+
+				const auto found = ptr_->object_data_->find(key);
+				if (found == ptr_->object_data_->end()) {
+					QJSON_THROW("Key " + key + " not found");
+				}
+
+				ptr_->object_data_->erase(found);
+			}
+
+			void del(const int index) {
+				if (ptr_ == nullptr) {
+					QJSON_THROW("Can't delete index on null pointer. Index: " + std::to_string(index));
+				}
+
+				if (ptr_->type_ != JsonType::ARRAY) {
+					QJSON_THROW("Can't delete index on non-array. Index: " + std::to_string(index));
+				}
+
+				if (index < 0 || index >= ptr_->array_data_->size()) {
+					QJSON_THROW("Index " + std::to_string(index) + " out of bounds");
+				}
+
+				if (ptr_->array_data_->size() == 1) {
+					ptr_->array_data_->clear();
+				} else {
+					ptr_->array_data_->erase(ptr_->array_data_->begin() + index);
+				}
+			}
+
+			ov_shared_ptr<JsonData> operator[] (const std::string_view key) const {
+				if (ptr_ == nullptr) {
+					QJSON_THROW("Can't access key on null pointer. Key: " + std::string(key));
+				}
+
+				return ov_shared_ptr<JsonData>(std::shared_ptr<JsonData>(ptr_, &(*ptr_)[key]));
+			}
+
+			/**
+			 * Like operator[], but a missing member (or a handle that is not an object) gives a null handle instead of
+			 * throwing, so optional members cost a single lookup:
+			 *
+			 *     if (const auto price = item.find("price")) { total += price.asDouble(); }
+			*/
+			[[nodiscard]] ov_shared_ptr<JsonData> find(const std::string_view key) const {
+				JsonData* const value = ptr_ == nullptr ? nullptr : ptr_->find(key);
+				if (value == nullptr) {
+					return nullptr;
+				}
+
+				return ov_shared_ptr<JsonData>(std::shared_ptr<JsonData>(ptr_, value));
+			}
+
+			ov_shared_ptr<JsonData> operator[] (const int index) const {
+				if (ptr_ == nullptr) {
+					QJSON_THROW("Can't access index on null pointer. Index: " + std::to_string(index));
+				}
+
+				return ov_shared_ptr<JsonData>(std::shared_ptr<JsonData>(ptr_, &(*ptr_)[index]));
+			}
+
+			T operator*() const {
+				return *ptr_;
+			}
+
+			bool operator== (const ov_shared_ptr<T>& other) const {
+				return ptr_ == other.ptr_;
+			}
+
+			bool operator!= (const ov_shared_ptr<T>& other) const {
+				return ptr_ != other.ptr_;
+			}
+
+			T* operator->() const {
+				return ptr_.get();
+			}
+
+			explicit operator bool() const {
+				return ptr_ != nullptr;
+			}
+
+			explicit operator std::string() const {
+				if (ptr_ == nullptr) {
+					QJSON_THROW("Can not convert null pointer to string");
+				}
+
+				return ptr_->toString();
+			}
+
+			[[nodiscard]] std::int64_t asInt() const {
+				if (ptr_ == nullptr) {
+					QJSON_THROW("Can not convert null pointer to integer");
+				}
+
+				return ptr_->asInt();
+			}
+
+			[[nodiscard]] double asDouble() const {
+				if (ptr_ == nullptr) {
+					QJSON_THROW("Can not convert null pointer to double");
+				}
+
+				return ptr_->asDouble();
+			}
+
+			[[nodiscard]] bool asBool() const {
+				if (ptr_ == nullptr) {
+					QJSON_THROW("Can not convert null pointer to boolean");
+				}
+
+				return ptr_->asBool();
+			}
+
+			[[nodiscard]] bool isNull() const {
+				if (ptr_ == nullptr) {
+					QJSON_THROW("Can not check null pointer for null");
+				}
+
+				return ptr_->isNull();
+			}
+
+			explicit operator T& () { return *ptr_; };
+			explicit operator const T& () const { return *ptr_; }
+
+			std::shared_ptr<T> ptr_;
+	};
+
+	inline std::ostream& operator<<(std::ostream &os, const ov_shared_ptr<JsonData>& ptr) {
+		return os << std::string(ptr);
+	}
+
+	using JsonDataPtr = ov_shared_ptr<JsonData>;
+	using json = JsonDataPtr; // shorter alias for user
+
+	/**
+	 * @class JsonData
+	 * JSON tree is built out of these blocks. Each block can be a string, number, boolean, null, object or array.
+	 * Numbers and booleans are converted once while parsing and stored inline. Strings and children live in the arena of
+	 * the owning Document. Allows subscript access.
+	 *
+	 * A block is a 16 byte tagged union: the type, the length of a string and one 8 byte payload holding either the value
+	 * itself or a pointer into the arena.
+	*/
+	class JsonData {
+		public:
+			JsonType type_ = JsonType::UNINIT;
+			std::uint32_t size_ = 0; // length of string_data_
+
+			[[nodiscard]] std::string_view asStringView() const {
+				if (type_ != JsonType::STRING) {
+					QJSON_THROW("Can not convert non-string type to string");
+				}
+
+				return {string_data_, size_};
+			}
+
+			void setString(const std::string_view text) {
+				if (text.size() > std::numeric_limits<std::uint32_t>::max()) {
+					QJSON_THROW("String too long: " + std::to_string(text.size()) + " bytes");
+				}
+
+				type_ = JsonType::STRING;
+				string_data_ = text.data();
+				size_ = static_cast<std::uint32_t>(text.size());
+			}
+
+			[[nodiscard]] std::int64_t asInt() const {
+				if (type_ != JsonType::INTEGER) {
+					QJSON_THROW("Can not convert non-integer type to integer");
+				}
+
+				return integer_data_;
+			}
+
+			[[nodiscard]] double asDouble() const {
+				if (type_ == JsonType::INTEGER) {
+					return static_cast<double>(integer_data_);
+				}
+
+				if (type_ != JsonType::DOUBLE) {
+					QJSON_THROW("Can not convert non-number type to double");
+				}
+
+				return double_data_;
+			}
+
+			[[nodiscard]] bool asBool() const {
+				if (type_ != JsonType::BOOLEAN) {
+					QJSON_THROW("Can not convert non-boolean type to boolean");
+				}
+
+				return bool_data_;
+			}
+
+			[[nodiscard]] bool isNull() const { return type_ == JsonType::NULL_VALUE; }
+			[[nodiscard]] bool isNumber() const { return type_ == JsonType::INTEGER || type_ == JsonType::DOUBLE; }
+
+			/**
+			 * Strings are returned as is, numbers, booleans and null are formatted the way they would be written in
+			 * JSON.
+			*/
+			[[nodiscard]] std::string toString() const {
+				switch (type_) {
+					case JsonType::STRING:
+						return {string_data_, size_};
+					case JsonType::INTEGER:
+						return std::to_string(integer_data_);
+					case JsonType::DOUBLE: {
+						char buffer[32];
+						const auto result = std::to_chars(buffer, buffer + sizeof(buffer), double_data_);
+						return {buffer, result.ptr};
+					}
+					case JsonType::BOOLEAN:
+						return bool_data_ ? "true" : "false";
+					case JsonType::NULL_VALUE:
+						return "null";
+					default:
+						QJSON_THROW("Can not convert non-string type to string");
+				}
+			}
+
+			// the member key, nullptr if there is none or this is not an object
+			[[nodiscard]] JsonData* find(const std::string_view key) const {
+				if (type_ != JsonType::OBJECT) {
+					return nullptr;
+				}
+
+				const auto found = object_data_->find(key);
+				return found == object_data_->end() ? nullptr : found->second;
+			}
+
+			JsonData& operator[] (const std::string_view key) const {
+				JsonData* const value = find(key);
+				if (value != nullptr) {
+					return *value;
+				}
+
+				if (type_ != JsonType::OBJECT) {
+					QJSON_THROW("Can't access key on non-object. Key: " + std::string(key));
+				}
+
+				QJSON_THROW("Key " + std::string(key) + " not found");
+			}
+
+			JsonData& operator[] (const int index) const {
+				if (type_ != JsonType::ARRAY) {
+					QJSON_THROW("Can't access index on non-array. Index: " + std::to_string(index));
+				}
+
+				if (index < 0 || index >= array_data_->size()) {
+					QJSON_THROW("Index " + std::to_string(index) + " out of bounds");
+				}
+
+				return *(*array_data_)[index];
+			}
+
+			union {
+				std::int64_t integer_data_ = 0;
+				double double_data_;
+				bool bool_data_;
+				const char* string_data_;
+				JsonObject* object_data_;
+				JsonArray* array_data_;
+			};
+	};
+
+	static_assert(sizeof(JsonData) == 16, "JsonData is expected to be a 16 byte tagged union");
+
+	inline bool isDigit(const char c) { return static_cast<unsigned char>(c - '0') < 10; }
+
+	/**
+	 * Converts a number once, while parsing, following the JSON grammar exactly: an optional minus, no leading zeros and
+	 * at least one digit after '.' and in the exponent. Integers that fit into 64 bits are kept exact, everything else
+	 * is stored as a double. Decimals with up to 15 or so significant digits and a small exponent are converted with a
+	 * single exact multiplication or division, the rest goes through from_chars, which rounds correctly. Like strtod,
+	 * numbers too small for a double become a signed zero and numbers too large become a signed infinity.
+	*/
+	inline bool parseNumber(const std::string_view number, JsonData& out) {
+		static constexpr double powers_of_ten[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+
+		const char* p = number.data();
+		const char* const end = p + number.size();
+
+		const bool negative = p != end && *p == '-';
+		if (negative) {
+			++p;
+		}
+
+		if (p == end || !isDigit(*p)) {
+			return false;
+		}
+
+		// the first 19 significant digits always fit, later ones only move the decimal point
+		std::uint64_t mantissa = 0;
+		int significant = 0;
+		bool truncated = false;
+		std::int64_t exponent = 0;
+
+		const auto digit = [&](const char c, const bool fraction) {
+			if (mantissa == 0 && c == '0') {
+				exponent -= fraction;
+			} else if (significant < 19) {
+				mantissa = mantissa * 10 + static_cast<std::uint64_t>(c - '0');
+				significant++;
+				exponent -= fraction;
+			} else {
+				truncated = true;
+				exponent += !fraction;
+			}
+		};
+
+		if (*p == '0') {
+			++p;
+		} else {
+			while (p != end && isDigit(*p)) {
+				digit(*p++, false);
+			}
+		}
+
+		bool integer = true;
+
+		if (p != end && *p == '.') {
+			integer = false;
+			if (++p == end || !isDigit(*p)) {
+				return false;
+			}
+
+			while (p != end && isDigit(*p)) {
+				digit(*p++, true);
+			}
+		}
+
+		if (p != end && (*p == 'e' || *p == 'E')) {
+			integer = false;
+			if (++p != end && (*p == '+' || *p == '-')) {
+				++p;
+			}
+
+			const bool negative_exponent = p[-1] == '-';
+			if (p == end || !isDigit(*p)) {
+				return false;
+			}
+
+			std::int64_t value = 0;
+			while (p != end && isDigit(*p)) {
+				// anything this large over- or underflows anyway
+				value = std::min<std::int64_t>(value * 10 + (*p++ - '0'), 1'000'000);
+			}
+
+			exponent += negative_exponent ? -value : value;
+		}
+
+		if (p != end) {
+			return false;
+		}
+
+		if (integer && !truncated) {
+			constexpr std::uint64_t max = std::numeric_limits<std::int64_t>::max();
+
+			if (mantissa <= max || (negative && mantissa == max + 1)) {
+				out.type_ = JsonType::INTEGER;
+				out.integer_data_ = static_cast<std::int64_t>(negative ? 0 - mantissa : mantissa);
+				return true;
+			}
+		}
+
+		if (!truncated && mantissa <= (std::uint64_t {1} << 53) && exponent >= -22 && exponent <= 22) {
+			// both operands are exact, so the one rounding step gives the correctly rounded result
+			double value = static_cast<double>(mantissa);
+			value = exponent < 0 ? value / powers_of_ten[-exponent] : value * powers_of_ten[exponent];
+
+			out.type_ = JsonType::DOUBLE;
+			out.double_data_ = negative ? -value : value;
+			return true;
+		}
+
+		const auto result = std::from_chars(number.data(), end, out.double_data_);
+		if (result.ptr != end) {
+			return false;
+		}
+
+		if (result.ec == std::errc::result_out_of_range) {
+			// the mantissa is not zero here, its leading digit is worth 10^(exponent + significant - 1)
+			const double value = exponent + significant <= 0 ? 0.0 : std::numeric_limits<double>::infinity();
+			out.double_data_ = negative ? -value : value;
+		} else if (result.ec != std::errc()) {
+			return false;
+		}
+
+		out.type_ = JsonType::DOUBLE;
+		return true;
+	}
+
+	inline bool parseLiteral(const std::string_view literal, JsonData& out) {
+		if (literal == "true" || literal == "false") {
+			out.type_ = JsonType::BOOLEAN;
+			out.bool_data_ = literal == "true";
+		} else if (literal == "null") {
+			out.type_ = JsonType::NULL_VALUE;
+		} else {
+			return false;
+		}
+
+		return true;
+	}
+
+	// value of the four hex digits at position, or more than 0xffff if they are not four hex digits
+	inline std::uint32_t parseHex4(const std::string_view text, const std::size_t position) {
+		if (position + 4 > text.size()) {
+			return 0x10000;
+		}
+
+		std::uint32_t value = 0;
+		const auto result = std::from_chars(text.data() + position, text.data() + position + 4, value, 16);
+		if (result.ptr != text.data() + position + 4) {
+			return 0x10000;
+		}
+
+		return value;
+	}
+
+	// writes code_point as UTF-8 to out, which has room for 4 bytes, and returns the number of bytes written
+	inline std::size_t encodeUtf8(const std::uint32_t code_point, char* out) {
+		if (code_point < 0x80) {
+			out[0] = static_cast<char>(code_point);
+			return 1;
+		}
+
+		if (code_point < 0x800) {
+			out[0] = static_cast<char>(0xc0 | (code_point >> 6));
+			out[1] = static_cast<char>(0x80 | (code_point & 0x3f));
+			return 2;
+		}
+
+		if (code_point < 0x10000) {
+			out[0] = static_cast<char>(0xe0 | (code_point >> 12));
+			out[1] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+			out[2] = static_cast<char>(0x80 | (code_point & 0x3f));
+			return 3;
+		}
+
+		out[0] = static_cast<char>(0xf0 | (code_point >> 18));
+		out[1] = static_cast<char>(0x80 | ((code_point >> 12) & 0x3f));
+		out[2] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+		out[3] = static_cast<char>(0x80 | (code_point & 0x3f));
+		return 4;
+	}
+
+	/**
+	 * Decodes the escape sequences of a string body (the bytes between its quotes) and passes the result on in pieces
+	 * to append(std::string_view). The runs between backslashes are found with memchr and passed on whole, \uXXXX
+	 * escapes become UTF-8, surrogate pairs are combined and lone surrogates rejected. A piece is never longer than the
+	 * input consumed to produce it, so the output can overwrite the input as it goes (and never reaches the escape that
+	 * failed). Returns the position of the first invalid escape sequence, npos if there is none.
+	*/
+	template <class Append> std::size_t unescape(const std::string_view raw, Append append) {
+		std::size_t position = 0;
+		while (true) {
+			const std::size_t backslash = raw.find('\\', position);
+			if (backslash == std::string_view::npos) {
+				append(raw.substr(position));
+				return std::string_view::npos;
+			}
+
+			append(raw.substr(position, backslash - position));
+			if (backslash + 1 == raw.size()) {
+				return backslash;
+			}
+
+			const char escaped = raw[backslash + 1];
+			position = backslash + 2;
+
+			char decoded[4];
+			std::size_t length = 1;
+
+			switch (escaped) {
+				case '"': case '\\': case '/': decoded[0] = escaped; break;
+				case 'b': decoded[0] = '\b'; break;
+				case 'f': decoded[0] = '\f'; break;
+				case 'n': decoded[0] = '\n'; break;
+				case 'r': decoded[0] = '\r'; break;
+				case 't': decoded[0] = '\t'; break;
+				case 'u': {
+					std::uint32_t code_point = parseHex4(raw, position);
+					position += 4;
+
+					if (code_point >= 0xd800 && code_point < 0xdc00) {
+						const std::uint32_t low = raw.substr(position, 2) == "\\u" ? parseHex4(raw, position + 2) : 0;
+						if (low < 0xdc00 || low >= 0xe000) {
+							return backslash;
+						}
+
+						code_point = 0x10000 + ((code_point - 0xd800) << 10) + (low - 0xdc00);
+						position += 6;
+					} else if (code_point > 0xffff || (code_point >= 0xdc00 && code_point < 0xe000)) {
+						return backslash;
+					}
+
+					length = encodeUtf8(code_point, decoded);
+					break;
+				}
+				default:
+					return backslash;
+			}
+
+			append(std::string_view(decoded, length));
+		}
+	}
+
+	inline std::size_t unescapeString(const std::string_view raw, std::string& out) {
+		out.clear();
+		out.reserve(raw.size());
+		return unescape(raw, [&out](const std::string_view piece) { out.append(piece); });
+	}
+
+	// decodes the string body at text in place and sets length to its new length
+	inline std::size_t unescapeInPlace(char* const text, std::size_t& length) {
+		char* out = text;
+		const std::size_t failed = unescape({text, length}, [&out](const std::string_view piece) {
+			std::memmove(out, piece.data(), piece.size());
+			out += piece.size();
+		});
+
+		length = static_cast<std::size_t>(out - text);
+		return failed;
+	}
+
+	// the escape sequence at position of a string body, for error messages
+	inline std::string_view escapeAt(const std::string_view raw, const std::size_t position) {
+		return raw.substr(position, position + 1 < raw.size() && raw[position + 1] == 'u' ? 6 : 2);
+	}
+
+	/**
+	 * @class Parser
+	 * Tokenizer shared by every front end. Runs the structural indexer over the input, checks the JSON grammar and
+	 * reports what it finds to a handler, which decides what to build (if anything). Handler calls are resolved at
+	 * compile time so they can be inlined. A handler provides:
+	 *
+	 *     void onStartObject();                 void onEndObject();
+	 *     void onStartArray();                  void onEndArray();
+	 *     void onKey(std::string_view key);     void onString(std::string_view text);
+	 *     void onNumber(std::int64_t value);    void onNumber(double value);
+	 *     void onBool(bool value);              void onNull();
+	 *
+	 * Strings passed to the handler are only valid during the call. Input can be given in any number of pieces, tokens
+	 * that are split between two pieces are put back together.
+	*/
+	template <class Handler> class Parser {
+		public:
+			explicit Parser(Handler& handler, const ParseOptions& options = {}) : handler_(handler), indexer_(options) {}
+
+			void parse(const char* data, const std::size_t length) {
+				if (!tryParse(data, length)) {
+					QJSON_THROW(message());
+				}
+			};
+
+			/**
+			 * Like parse, but strings are decoded inside the buffer and null terminated there (over their closing
+			 * quote), so the views given to the handler stay valid as long as the buffer does.
+			*/
+			void parseInSitu(char* data, const std::size_t length) {
+				in_situ_ = data;
+				in_situ_length_ = length;
+				const bool parsed = tryParse(data, length);
+				in_situ_ = nullptr;
+
+				if (!parsed) {
+					QJSON_THROW(message());
+				}
+			};
+
+			// call once all input was given to parse
+			void finish() {
+				if (!tryFinish()) {
+					QJSON_THROW(message());
+				}
+			};
+
+			/**
+			 * parse and finish without exceptions. They return false once the input turned out to be invalid, error()
+			 * and errorOffset() then tell why and where. After an error nothing more is parsed until reset().
+			*/
+			bool tryParse(const char* data, const std::size_t length) {
+				if (error_ != ErrorCode::NONE) {
+					return false;
+				}
+
+				for (std::size_t offset = 0; offset < length; offset += window_size_) {
+					const std::size_t size = std::min(window_size_, length - offset);
+					if (!parseWindow(data + offset, size)) {
+						return false;
+					}
+
+					consumed_ += size;
+				}
+
+				return true;
+			};
+
+			bool tryFinish() {
+				if (error_ != ErrorCode::NONE) {
+					return false;
+				}
+
+				token_ = consumed_;
+				if (!indexer_.finish()) {
+					return fail(ErrorCode::INVALID_UTF8, "input ends inside a character");
+				}
+
+				if (in_scalar_) {
+					in_scalar_ = false;
+					token_ = text_start_;
+					if (!scalar(text_)) {
+						return false;
+					}
+				}
+
+				if (in_string_) {
+					token_ = text_start_;
+					return fail(ErrorCode::UNCLOSED_STRING);
+				}
+
+				token_ = consumed_;
+				if (!containers_.empty()) {
+					return fail(ErrorCode::UNCLOSED_BRACKET, {&containers_.back(), 1});
+				}
+
+				if (expect_ != Expect::END) {
+					return fail(ErrorCode::EMPTY);
+				}
+
+				return true;
+			};
+
+			[[nodiscard]] ErrorCode error() const { return error_; };
+
+			// counted from the first byte parsed since the parser was created or reset
+			[[nodiscard]] std::size_t errorOffset() const { return error_offset_; };
+
+			// what the exception for the error says
+			[[nodiscard]] std::string message() const {
+				std::string message = describe(error_);
+				if (!error_detail_.empty()) {
+					message += ": ";
+					message += error_detail_;
+				}
+
+				return message;
+			};
+
+			// true as long as nothing but whitespace was parsed
+			[[nodiscard]] bool empty() const {
+				return expect_ == Expect::VALUE && containers_.empty() && !in_string_ && !in_scalar_;
+			};
+
+			// start over with a new document, buffers are kept
+			void reset() {
+				indexer_.reset();
+				containers_.clear();
+				expect_ = Expect::VALUE;
+				text_.clear();
+				in_string_ = false;
+				in_scalar_ = false;
+				in_situ_ = nullptr;
+				consumed_ = 0;
+				error_ = ErrorCode::NONE;
+				error_detail_.clear();
+			};
+
+		private:
+			enum struct Expect {
+				VALUE,
+				VALUE_OR_CLOSE, // right after [
+				KEY,
+				KEY_OR_CLOSE, // right after {
+				COLON,
+				COMMA_OR_CLOSE,
+				END
+			};
+
+			static constexpr std::size_t window_size_ = 64 * 1024; // keeps the structural index of a window in cache
+
+			Handler& handler_;
+			StructuralIndexer indexer_;
+			std::vector<std::uint32_t> positions_;
+
+			std::vector<char> containers_; // opening bracket of every open container
+			Expect expect_ = Expect::VALUE;
+
+			// string or number that continues past the end of the current window, and the offset it starts at
+			std::string text_;
+			std::size_t text_start_ = 0;
+			bool in_string_ = false;
+			bool in_scalar_ = false;
+			// decoded copy of the last string that had escapes
+			std::string unescaped_;
+
+			// buffer given to parseInSitu, strings inside it are rewritten in place
+			char* in_situ_ = nullptr;
+			std::size_t in_situ_length_ = 0;
+
+			// offsets, from the first byte since reset, of the current window and of the token being handled
+			std::size_t consumed_ = 0;
+			std::size_t token_ = 0;
+
+			ErrorCode error_ = ErrorCode::NONE;
+			std::size_t error_offset_ = 0;
+			std::string error_detail_;
+
+			// stage 2 runs over the positions indexed before an error in stage 1, so the first error is the one reported
+			bool parseWindow(const char* buffer, const std::size_t length) {
+				const bool indexed = indexer_.index(buffer, length, positions_);
+				if (!parsePositions(buffer, length)) {
+					return false;
+				}
+
+				if (!indexed) {
+					token_ = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(consumed_) + indexer_.errorOffset());
+					return fail(indexer_.error());
+				}
+
+				return true;
+			};
+
+			bool parsePositions(const char* buffer, const std::size_t length) {
+				std::size_t next = 0;
+
+				if (in_scalar_) {
+					std::size_t end = 0;
+					while (end < length && isScalarPart(buffer[end])) {
+						end++;
+					}
+
+					text_.append(buffer, end);
+					if (end == length) {
+						return true;
+					}
+
+					in_scalar_ = false;
+					token_ = text_start_;
+					if (!scalar(text_)) {
+						return false;
+					}
+
+					if (end > 0) {
+						next++; // the indexer recorded the rest of the number as a new one
+					}
+				} else if (in_string_) {
+					if (positions_.empty()) {
+						text_.append(buffer, length);
+						return true;
+					}
+
+					text_.append(buffer, positions_[next]);
+					in_string_ = false;
+					token_ = text_start_;
+					if (!string(text_)) {
+						return false;
+					}
+
+					next++;
+				}
+
+				for (; next < positions_.size(); next++) {
+					const std::uint32_t position = positions_[next];
+					const char c = buffer[position];
+					token_ = consumed_ + position;
+
+					if (c == '"') {
+						// inside a string only its closing quote is recorded
+						if (next + 1 < positions_.size()) {
+							const std::uint32_t closing = positions_[++next];
+							if (!string({buffer + position + 1, closing - position - 1})) {
+								return false;
+							}
+						} else {
+							text_.assign(buffer + position + 1, length - position - 1);
+							text_start_ = token_;
+							in_string_ = true;
+						}
+					} else if (isStructural(c)) {
+						if (!structural(c)) {
+							return false;
+						}
+					} else {
+						std::size_t end = position + 1;
+						while (end < length && isScalarPart(buffer[end])) {
+							end++;
+						}
+
+						if (end < length) {
+							if (!scalar({buffer + position, end - position})) {
+								return false;
+							}
+						} else {
+							text_.assign(buffer + position, end - position);
+							text_start_ = token_;
+							in_scalar_ = true;
+						}
+					}
+				}
+
+				return true;
+			};
+
+			// records the error at the current token, always false
+			bool fail(const ErrorCode code, const std::string_view detail = {}) {
+				error_ = code;
+				error_offset_ = token_;
+				error_detail_.assign(detail.data(), detail.size());
+				return false;
+			};
+
+			// the writable address of a string body inside the in situ buffer, with room for a terminator after it
+			char* inSitu(const std::string_view text) const {
+				if (in_situ_ == nullptr) {
+					return nullptr;
+				}
+
+				const auto offset = reinterpret_cast<std::uintptr_t>(text.data()) - reinterpret_cast<std::uintptr_t>(in_situ_);
+				if (offset >= in_situ_length_ || in_situ_length_ - offset <= text.size()) {
+					return nullptr;
+				}
+
+				return in_situ_ + offset;
+			};
+
+			bool unexpected(const char c) {
+				const std::string_view character {&c, 1};
+
+				switch (expect_) {
+					case Expect::END:
+						return fail(ErrorCode::TRAILING_CONTENT);
+					case Expect::COLON:
+						return fail(ErrorCode::EXPECTED_COLON);
+					case Expect::COMMA_OR_CLOSE:
+						return fail(ErrorCode::EXPECTED_COMMA_OR_CLOSE, character);
+					case Expect::KEY:
+					case Expect::KEY_OR_CLOSE:
+						return fail(ErrorCode::EXPECTED_KEY, character);
+					default:
+						return fail(ErrorCode::UNEXPECTED_CHARACTER, character);
+				}
+			};
+
+			bool beginValue(const char c) {
+				return expect_ == Expect::VALUE || expect_ == Expect::VALUE_OR_CLOSE || unexpected(c);
+			};
+
+			void endValue() { expect_ = containers_.empty() ? Expect::END : Expect::COMMA_OR_CLOSE; };
+
+			bool structural(const char c) {
+				switch (c) {
+					case '{':
+					case '[':
+						if (!beginValue(c)) {
+							return false;
+						}
+
+						containers_.push_back(c);
+
+						if (c == '{') {
+							handler_.onStartObject();
+							expect_ = Expect::KEY_OR_CLOSE;
+						} else {
+							handler_.onStartArray();
+							expect_ = Expect::VALUE_OR_CLOSE;
+						}
+						break;
+					case '}':
+					case ']':
+						if (containers_.empty()) {
+							return fail(ErrorCode::UNMATCHED_CLOSE);
+						}
+
+						if ((c == '}') != (containers_.back() == '{')) {
+							return fail(ErrorCode::BRACKET_MISMATCH, std::string(1, c) + " is closing " + containers_.back());
+						}
+
+						if (
+							expect_ != Expect::COMMA_OR_CLOSE
+							&& !(c == '}' && expect_ == Expect::KEY_OR_CLOSE)
+							&& !(c == ']' && expect_ == Expect::VALUE_OR_CLOSE)
+						) {
+							return unexpected(c);
+						}
+
+						containers_.pop_back();
+
+						if (c == '}') {
+							handler_.onEndObject();
+						} else {
+							handler_.onEndArray();
+						}
+
+						endValue();
+						break;
+					case ':':
+						if (expect_ != Expect::COLON) {
+							return unexpected(c);
+						}
+
+						expect_ = Expect::VALUE;
+						break;
+					default: // ,
+						if (expect_ != Expect::COMMA_OR_CLOSE) {
+							return unexpected(c);
+						}
+
+						expect_ = containers_.back() == '{' ? Expect::KEY : Expect::VALUE;
+						break;
+				}
+
+				return true;
+			};
+
+			bool string(std::string_view text) {
+				char* const writable = inSitu(text);
+
+				// most strings have no escapes and are handed over as they are
+				if (text.find('\\') != std::string_view::npos) {
+					const std::string_view raw = text;
+					std::size_t failed;
+
+					if (writable != nullptr) {
+						std::size_t length = text.size();
+						failed = unescapeInPlace(writable, length);
+						text = {writable, length};
+					} else {
+						failed = unescapeString(text, unescaped_);
+						text = unescaped_;
+					}
+
+					if (failed != std::string_view::npos) {
+						token_ += 1 + failed;
+						return fail(ErrorCode::INVALID_ESCAPE, escapeAt(raw, failed));
+					}
+				}
+
+				if (writable != nullptr) {
+					writable[text.size()] = '\0';
+				}
+
+				if (expect_ == Expect::KEY || expect_ == Expect::KEY_OR_CLOSE) {
+					handler_.onKey(text);
+					expect_ = Expect::COLON;
+					return true;
+				}
+
+				if (!beginValue('"')) {
+					return false;
+				}
+
+				handler_.onString(text);
+				endValue();
+				return true;
+			};
+
+			bool scalar(const std::string_view text) {
+				if (!beginValue(text[0])) {
+					return false;
+				}
+
+				JsonData value;
+				if (text[0] == '-' || (text[0] >= '0' && text[0] <= '9')) {
+					if (!parseNumber(text, value)) {
+						return fail(ErrorCode::INVALID_NUMBER, text);
+					}
+				} else if (!parseLiteral(text, value)) {
+					return fail(ErrorCode::INVALID_LITERAL, text);
+				}
+
+				switch (value.type_) {
+					case JsonType::INTEGER:
+						handler_.onNumber(value.integer_data_);
+						break;
+					case JsonType::DOUBLE:
+						handler_.onNumber(value.double_data_);
+						break;
+					case JsonType::BOOLEAN:
+						handler_.onBool(value.bool_data_);
+						break;
+					default:
+						handler_.onNull();
+						break;
+				}
+
+				endValue();
+				return true;
+			};
+	};
+
+	inline constexpr std::streamsize stream_buffer_size = 4096;
+
+	/**
+	 * Runs handler over a whole JSON document in memory (SAX style), without building a tree.
+	*/
+	template <class Handler> void parse(
+		const char* data,
+		const std::size_t length,
+		Handler& handler,
+		const ParseOptions& options = {}
+	) {
+		Parser<Handler> parser {handler, options};
+		parser.parse(data, length);
+		parser.finish();
+	}
+
+	/**
+	 * Like parse, but invalid input is reported instead of thrown, so it also works with -fno-exceptions. The handler
+	 * may already have seen part of the document when an error is returned.
+	*/
+	template <class Handler> ParseError tryParse(
+		const char* data,
+		const std::size_t length,
+		Handler& handler,
+		const ParseOptions& options = {}
+	) {
+		Parser<Handler> parser {handler, options};
+		if (!parser.tryParse(data, length) || !parser.tryFinish()) {
+			return locate(parser.error(), parser.errorOffset(), data, length);
+		}
+
+		return {};
+	}
+
+	/**
+	 * Runs handler over a JSON file (SAX style). In STREAM mode the file is read in small chunks, so memory use does not
+	 * depend on the size of the file.
+	*/
+	template <class Handler> void parseFile(
+		const std::string& filename,
+		Handler& handler,
+		const InputMode mode = InputMode::STREAM,
+		const ParseOptions& options = {}
+	) {
+		if (mode == InputMode::MMAP && MappedFile::supported) {
+			const MappedFile mapped_file {filename};
+			parse(mapped_file.data(), mapped_file.size(), handler, options);
+			return;
+		}
+
+		std::ifstream file {filename, std::ios::binary};
+		if (!file) {
+			QJSON_THROW("Can't open file: " + filename);
+		}
+
+		Parser<Handler> parser {handler, options};
+		const std::unique_ptr<char[]> buffer {new char[stream_buffer_size]};
+
+		while (file) {
+			file.read(buffer.get(), stream_buffer_size);
+			parser.parse(buffer.get(), static_cast<std::size_t>(file.gcount()));
+		}
+
+		parser.finish();
+	}
+
+	/**
+	 * @class DomBuilder
+	 * Parser handler that builds the JsonData tree of a Json inside the arena of a Document.
+	*/
+	class DomBuilder {
+		public:
+			// options.keys, if set, becomes the key dictionary of the document
+			explicit DomBuilder(Document& document, const ParseOptions& options = {}) : document_(&document) {
+				if (options.keys != nullptr) {
+					document.keys_ = options.keys;
+				}
+			}
+
+			// start building a new tree into document
+			void reset(Document& document) {
+				document_ = &document;
+				containers_.clear();
+				object_starts_.clear();
+				member_keys_.clear();
+				member_values_.clear();
+			}
+
+			void onStartObject() { open(JsonType::OBJECT); }
+			void onStartArray() { open(JsonType::ARRAY); }
+			void onEndObject() { close(); }
+			void onEndArray() { containers_.pop_back(); }
+
+			// strings that lie in this buffer are kept as views into it instead of being copied
+			void borrow(const char* data, const std::size_t length) {
+				borrowed_begin_ = reinterpret_cast<std::uintptr_t>(data);
+				borrowed_end_ = borrowed_begin_ + length;
+			}
+
+			void onKey(const std::string_view key) { key_ = document_->keys_->intern(key); }
+
+			void onString(const std::string_view text) {
+				JsonData* const value = makeNode();
+				value->setString(store(text));
+				add(value);
+			}
+
+			void onNumber(const std::int64_t number) {
+				JsonData* const value = makeNode();
+				value->type_ = JsonType::INTEGER;
+				value->integer_data_ = number;
+				add(value);
+			}
+
+			void onNumber(const double number) {
+				JsonData* const value = makeNode();
+				value->type_ = JsonType::DOUBLE;
+				value->double_data_ = number;
+				add(value);
+			}
+
+			void onBool(const bool boolean) {
+				JsonData* const value = makeNode();
+				value->type_ = JsonType::BOOLEAN;
+				value->bool_data_ = boolean;
+				add(value);
+			}
+
+			void onNull() {
+				JsonData* const value = makeNode();
+				value->type_ = JsonType::NULL_VALUE;
+				add(value);
+			}
+
+		private:
+			Document* document_;
+			std::vector<JsonData*> containers_;
+			const Key* key_ = nullptr;
+			// members of the open objects, each object's start at the back of object_starts_
+			std::vector<std::size_t> object_starts_;
+			std::vector<const Key*> member_keys_;
+			std::vector<JsonData*> member_values_;
+			std::uintptr_t borrowed_begin_ = 0;
+			std::uintptr_t borrowed_end_ = 0;
+
+			// objects with more keys are mostly maps keyed by data (ids, names), their shapes would not be shared
+			static constexpr std::size_t max_shared_keys_ = 32;
+
+			JsonData* makeNode() { return document_->arena_.create<JsonData>(); }
+
+			// decoded strings and ones that crossed a window of the parser are not in the input and get copied
+			std::string_view store(const std::string_view text) {
+				const auto address = reinterpret_cast<std::uintptr_t>(text.data());
+				if (address >= borrowed_begin_ && address + text.size() <= borrowed_end_) {
+					return text;
+				}
+
+				return document_->arena_.copyString(text);
+			}
+
+			// containers are linked into their parent as soon as they open, arena nodes never move
+			void open(const JsonType type) {
+				Arena& arena = document_->arena_;
+				JsonData* const container = makeNode();
+				container->type_ = type;
+
+				if (type == JsonType::ARRAY) {
+					container->array_data_ = arena.create<JsonArray>(ArenaAllocator<JsonData*>(arena));
+				}
+
+				add(container);
+				containers_.push_back(container);
+
+				if (type == JsonType::OBJECT) {
+					object_starts_.push_back(member_keys_.size());
+				}
+			}
+
+			// objects get their members once all keys are known, so objects with the same keys can share a shape
+			void close() {
+				Arena& arena = document_->arena_;
+				KeyDictionary& dictionary = *document_->keys_;
+
+				const std::size_t first = object_starts_.back();
+				const std::size_t count = member_keys_.size() - first;
+				auto** const values = static_cast<JsonData**>(arena.allocate(count * sizeof(JsonData*), alignof(JsonData*)));
+				std::size_t size = 0;
+				Shape* shape;
+
+				// the first of duplicate keys wins
+				if (count <= max_shared_keys_) {
+					shape = dictionary.root();
+					for (std::size_t i = first; i < member_keys_.size() && shape != nullptr; ++i) {
+						Shape* const next = dictionary.extend(shape, member_keys_[i]);
+						if (next != shape) {
+							shape = next;
+							values[size++] = member_values_[i];
+						}
+					}
+				} else {
+					shape = nullptr;
+				}
+
+				if (shape == nullptr) {
+					size = 0;
+					shape = arena.create<Shape>(arena, count, false);
+					for (std::size_t i = first; i < member_keys_.size(); ++i) {
+						if (shape->append(arena, member_keys_[i])) {
+							values[size++] = member_values_[i];
+						}
+					}
+				}
+
+				containers_.back()->object_data_ = arena.create<JsonObject>(dictionary, shape, values);
+				containers_.pop_back();
+
+				object_starts_.pop_back();
+				member_keys_.resize(first);
+				member_values_.resize(first);
+			}
+
+			void add(JsonData* value) {
+				if (containers_.empty()) {
+					document_->root_ = value;
+				} else if (containers_.back()->type_ == JsonType::OBJECT) {
+					member_keys_.push_back(key_);
+					member_values_.push_back(value);
+				} else {
+					containers_.back()->array_data_->push_back(value);
+				}
+			}
+	};
+
+	/**
+	 * @class ParallelArrayParser
+	 * Speculative multi-threaded parsing of one large document whose root is an array. The input is cut into a segment
+	 * per thread and a few cheap passes over the segments, all run in parallel, find out whether each segment starts
+	 * inside a string (parity of the unescaped quotes), how deeply nested it starts, and where its first comma between
+	 * two root elements is. The runs of root elements between those commas are then parsed on all threads into
+	 * documents of their own and stitched together under the root of the first one. Documents with any other root are
+	 * parsed on the calling thread.
+	*/
+	class ParallelArrayParser {
+		public:
+			static std::shared_ptr<Document> parse(
+				const char* data,
+				const std::size_t length,
+				const unsigned threads,
+				const ParseOptions& options = {}
+			) {
+				const std::size_t segment_count = std::min<std::size_t>(threads, length / min_segment_size_);
+				const std::size_t first = std::string_view(data, length).find_first_not_of(" \t\n\r");
+				if (segment_count < 2 || first == std::string_view::npos || data[first] != '[') {
+					return serial(data, length, options);
+				}
+
+				std::vector<std::size_t> bounds(segment_count + 1);
+				for (std::size_t i = 0; i <= segment_count; ++i) {
+					bounds[i] = length / segment_count * i;
+				}
+				bounds.back() = length;
+
+				// 1. quote parity of every segment tells whether the next one starts inside a string
+				std::vector<std::uint64_t> in_string(segment_count);
+				parallelFor(segment_count, [&](const std::size_t i) {
+					std::uint64_t parity = 0;
+					std::uint64_t escape_carry = escapedAt(data, bounds[i]);
+					for (std::size_t offset = bounds[i]; offset < bounds[i + 1]; offset += block_size) {
+						const BlockMasks masks = classify(data, offset, bounds[i + 1]);
+						parity ^= std::popcount(masks.quote & ~escapedChars(masks.backslash, escape_carry));
+					}
+
+					in_string[i] = parity & 1;
+				});
+
+				// 2. change in nesting depth over every segment, outside of strings
+				std::uint64_t inside = 0;
+				for (std::uint64_t& state : in_string) {
+					const std::uint64_t parity = state;
+					state = inside;
+					inside ^= std::uint64_t {0} - parity;
+				}
+
+				std::vector<std::int64_t> depth(segment_count);
+				parallelFor(segment_count, [&](const std::size_t i) {
+					std::int64_t change = 0;
+					scan(data, bounds[i], bounds[i + 1], in_string[i], [&](const std::size_t, const char c) {
+						change += nesting(c);
+						return false;
+					});
+
+					depth[i] = change;
+				});
+
+				// 3. the first comma directly inside the root in every segment
+				std::int64_t start_depth = 0;
+				for (std::int64_t& change : depth) {
+					const std::int64_t segment_change = change;
+					change = start_depth;
+					start_depth += segment_change;
+				}
+
+				// the first piece starts at the beginning of the input, so only the later segments need a split
+				std::vector<std::size_t> splits(segment_count - 1, length);
+				parallelFor(segment_count - 1, [&](const std::size_t split) {
+					const std::size_t i = split + 1;
+					std::int64_t current = depth[i];
+					scan(data, bounds[i], bounds[i + 1], in_string[i], [&](const std::size_t position, const char c) {
+						current += nesting(c);
+						if (c == ',' && current == 1) {
+							splits[split] = position;
+							return true;
+						}
+
+						return false;
+					});
+				});
+
+				splits.erase(std::remove(splits.begin(), splits.end(), length), splits.end());
+				if (splits.empty()) {
+					return serial(data, length, options);
+				}
+
+				// 4. every run of root elements is parsed as an array of its own: "[" run "]"
+				const auto document = std::make_shared<Document>();
+				const std::size_t piece_count = splits.size() + 1;
+				std::vector<std::shared_ptr<Document>> pieces(piece_count);
+				parallelFor(piece_count, [&](const std::size_t i) {
+					const std::size_t begin = i == 0 ? 0 : splits[i - 1] + 1;
+					const std::size_t end = i == splits.size() ? length : splits[i];
+
+					pieces[i] = i == 0 ? document : std::make_shared<Document>();
+					// a shared key dictionary is not synchronised, every piece interns into its own
+					DomBuilder builder {*pieces[i]};
+					if (options.zero_copy) {
+						builder.borrow(data, length);
+					}
+
+					Parser<DomBuilder> parser {builder, options};
+
+					if (i != 0) {
+						parser.parse("[", 1);
+					}
+
+					parser.parse(data + begin, end - begin);
+
+					if (i != splits.size()) {
+						parser.parse("]", 1);
+					}
+
+					parser.finish();
+
+					if (pieces[i]->root_->array_data_->empty()) {
+						QJSON_THROW("Unexpected ,");
+					}
+				});
+
+				// 5. stitch: the root of the first piece takes over the elements of all others
+				JsonArray& root = *document->root_->array_data_;
+
+				std::size_t total = 0;
+				for (const auto& piece : pieces) {
+					total += piece->root_->array_data_->size();
+				}
+
+				root.reserve(total);
+				for (std::size_t i = 1; i < piece_count; ++i) {
+					const JsonArray& elements = *pieces[i]->root_->array_data_;
+					root.insert(root.end(), elements.begin(), elements.end());
+					document->parts_.push_back(std::move(pieces[i]));
+				}
+
+				return document;
+			};
+
+		private:
+			// below this there is not enough work to be worth a thread
+			static constexpr std::size_t min_segment_size_ = 1024 * 1024;
+
+			// options.keys is ignored here too, a document parsed in parallel never shares its dictionary
+			static std::shared_ptr<Document> serial(const char* data, const std::size_t length, const ParseOptions& options) {
+				auto document = std::make_shared<Document>();
+				DomBuilder builder {*document};
+				if (options.zero_copy) {
+					builder.borrow(data, length);
+				}
+
+				qjson::parse(data, length, builder, options);
+				return document;
+			};
+
+			static BlockMasks classify(const char* data, const std::size_t offset, const std::size_t end) {
+				if (end - offset >= block_size) {
+					return classifyBlock(data + offset);
+				}
+
+				char padded[block_size];
+				std::memset(padded, ' ', block_size);
+				std::memcpy(padded, data + offset, end - offset);
+				return classifyBlock(padded);
+			};
+
+			// 1 if the character at position is escaped, i.e. follows a run of backslashes of odd length
+			static std::uint64_t escapedAt(const char* data, const std::size_t position) {
+				std::size_t start = position;
+				while (start > 0 && data[start - 1] == '\\') {
+					start--;
+				}
+
+				return (position - start) & 1;
+			};
+
+			static int nesting(const char c) {
+				switch (c) {
+					case '[': case '{': return 1;
+					case ']': case '}': return -1;
+					default: return 0;
+				}
+			};
+
+			// calls visit(position, character) for every structural character outside of strings until it returns true
+			template <class Visit>
+			static void scan(const char* data, const std::size_t begin, const std::size_t end, std::uint64_t in_string, Visit visit) {
+				std::uint64_t escape_carry = escapedAt(data, begin);
+				for (std::size_t offset = begin; offset < end; offset += block_size) {
+					const BlockMasks masks = classify(data, offset, end);
+
+					const std::uint64_t quote = masks.quote & ~escapedChars(masks.backslash, escape_carry);
+					const std::uint64_t inside = prefixXor(quote) ^ in_string;
+					in_string = std::uint64_t {0} - (inside >> 63);
+
+					std::uint64_t structural = masks.structural & ~inside;
+					if (end - offset < block_size) {
+						structural &= (std::uint64_t {1} << (end - offset)) - 1;
+					}
+
+					while (structural != 0) {
+						const std::size_t position = offset + std::countr_zero(structural);
+						if (visit(position, data[position])) {
+							return;
+						}
+
+						structural &= structural - 1;
+					}
+				}
+			};
+
+			// runs work(0) ... work(count - 1) on threads of their own, the first error (by index) is rethrown
+			template <class Work>
+			static void parallelFor(const std::size_t count, Work work) {
+				std::vector<std::exception_ptr> errors(count);
+				std::vector<std::thread> workers;
+				workers.reserve(count);
+
+				for (std::size_t i = 0; i < count; ++i) {
+					workers.emplace_back([&, i] { errors[i] = captureException([&] { work(i); }); });
+				}
+
+				for (std::thread& worker : workers) {
+					worker.join();
+				}
+
+				for (const std::exception_ptr& error : errors) {
+					if (error) {
+						std::rethrow_exception(error);
+					}
+				}
+			};
+	};
+
+	// selects the in situ constructor of Json, so a plain char* never ends up there by accident
+	struct InSitu {
+		explicit InSitu() = default;
+	};
+
+	inline constexpr InSitu in_situ {};
+
+	/**
+	 * @class Json
+	 * Load file (or in-memory buffer) in constructor and parse it into a tree structure. Access data with subscript
+	 * operator.
+	*/
+	class Json {
+		public:
+			explicit Json(
+				const std::string& filename,
+				const InputMode mode = InputMode::STREAM,
+				const ParseOptions& options = {}
+			) {
+				DomBuilder builder {*document_, options};
+
+				if (options.zero_copy && mode == InputMode::MMAP && MappedFile::supported) {
+					document_->source_ = MappedFile(filename);
+					builder.borrow(document_->source_.data(), document_->source_.size());
+					parse(document_->source_.data(), document_->source_.size(), builder, options);
+				} else {
+					parseFile(filename, builder, mode, options);
+				}
+
+				root_ = document_->root_;
+			};
+
+			/**
+			 * Parse JSON straight from memory. The buffer does not have to be null terminated, and is only read during
+			 * construction unless options.zero_copy is set.
+			*/
+			Json(const char* data, const std::size_t length, const ParseOptions& options = {}) {
+				DomBuilder builder {*document_, options};
+				if (options.zero_copy) {
+					builder.borrow(data, length);
+				}
+
+				parse(data, length, builder, options);
+				root_ = document_->root_;
+			};
+
+			explicit Json(const std::span<const std::byte> bytes, const ParseOptions& options = {})
+				: Json(reinterpret_cast<const char*>(bytes.data()), bytes.size(), options)
+			{};
+
+			static Json fromString(const std::string_view text, const ParseOptions& options = {}) {
+				return {text.data(), text.size(), options};
+			};
+
+			/**
+			 * Parse JSON from memory without throwing for invalid input. The result holds the document, or the error
+			 * with its offset, line and column.
+			 *
+			 *     const auto result = qjson::Json::tryParse(body);
+			 *     if (!result) { ... result.error() ... }
+			*/
+			static ParseResult<Json> tryParse(const char* data, const std::size_t length, const ParseOptions& options = {}) {
+				auto document = std::make_shared<Document>();
+				DomBuilder builder {*document, options};
+				if (options.zero_copy) {
+					builder.borrow(data, length);
+				}
+
+				if (const ParseError error = qjson::tryParse(data, length, builder, options)) {
+					return error;
+				}
+
+				return Json(std::move(document));
+			};
+
+			static ParseResult<Json> tryParse(const std::string_view text, const ParseOptions& options = {}) {
+				return tryParse(text.data(), text.size(), options);
+			};
+
+			/**
+			 * In situ parsing of a buffer that is thrown away afterwards: escapes are decoded inside the buffer and every
+			 * string is null terminated there, so no memory is needed for strings at all. The buffer is overwritten and
+			 * has to outlive the document.
+			 *
+			 *     qjson::Json json (qjson::in_situ, buffer.data(), buffer.size());
+			*/
+			Json(InSitu, char* data, const std::size_t length, const ParseOptions& options = {}) {
+				DomBuilder builder {*document_, options};
+				builder.borrow(data, length);
+
+				Parser<DomBuilder> parser {builder, options};
+				parser.parseInSitu(data, length);
+				parser.finish();
+				root_ = document_->root_;
+			};
+
+			/**
+			 * Parse a large document on several threads. Only pays off for a root array with many elements, anything
+			 * else is parsed on the calling thread. Files are read completely before parsing starts. ParseOptions::keys
+			 * is ignored, every thread interns keys into a dictionary of its own.
+			*/
+			static Json parallel(
+				const char* data,
+				const std::size_t length,
+				const unsigned threads = std::thread::hardware_concurrency(),
+				const ParseOptions& options = {}
+			) {
+				return Json(ParallelArrayParser::parse(data, length, std::max(threads, 1u), options));
+			};
+
+			static Json parallel(
+				const std::string& filename,
+				const InputMode mode,
+				const unsigned threads = std::thread::hardware_concurrency(),
+				const ParseOptions& options = {}
+			) {
+				if (mode == InputMode::MMAP && MappedFile::supported) {
+					MappedFile file {filename};
+					auto document = ParallelArrayParser::parse(file.data(), file.size(), std::max(threads, 1u), options);
+					if (options.zero_copy) {
+						document->source_ = std::move(file);
+					}
+
+					return Json(std::move(document));
+				}
+
+				std::ifstream file {filename, std::ios::binary};
+				if (!file) {
+					QJSON_THROW("Can't open file: " + filename);
+				}
+
+				// the contents go away with this call, nothing can point into them
+				ParseOptions copying = options;
+				copying.zero_copy = false;
+
+				const std::vector<char> contents {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+				return parallel(contents.data(), contents.size(), threads, copying);
+			};
+
+			ov_shared_ptr<JsonData> operator[] (const int index) const {
+				const JsonData& root = *root_;
+				if (root.type_ != JsonType::ARRAY) {
+					QJSON_THROW("JSON Parser: Can't access index on non-array");
+				}
+
+				if (index < 0 || index >= root.array_data_->size()) {
+					QJSON_THROW("JSON Parser: Index " + std::to_string(index) + " out of bounds");
+				}
+
+				return handle((*root.array_data_)[index]);
+			}
+
+			ov_shared_ptr<JsonData> operator[] (const std::string_view key) const {
+				JsonData* const value = root_->find(key);
+				if (value != nullptr) {
+					return handle(value);
+				}
+
+				if (root_->type_ != JsonType::OBJECT) {
+					QJSON_THROW("JSON Parser: Can't access key on non-object");
+				}
+
+				QJSON_THROW("JSON Parser: Key " + std::string(key) + " not found");
+			}
+
+			// member of the root, a null handle if there is none
+			[[nodiscard]] ov_shared_ptr<JsonData> find(const std::string_view key) const {
+				JsonData* const value = root_->find(key);
+				return value == nullptr ? nullptr : handle(value);
+			}
+
+			~Json() = default;
+		private:
+			friend class IncrementalParser;
+			friend class NdjsonReader;
+			friend class ParallelNdjsonReader;
+
+			// every node of the tree is allocated from the document's arena
+			std::shared_ptr<Document> document_ = std::make_shared<Document>();
+			// usually the document's root, but the records of one NDJSON chunk share a document
+			JsonData* root_ = nullptr;
+
+			explicit Json(std::shared_ptr<Document> document) : document_(std::move(document)), root_(document_->root_) {};
+
+			Json(std::shared_ptr<Document> document, JsonData* root) : document_(std::move(document)), root_(root) {};
+
+			ov_shared_ptr<JsonData> handle(JsonData* node) const {
+				return ov_shared_ptr<JsonData>(std::shared_ptr<JsonData>(document_, node));
+			};
+	};
+
+	/**
+	 * @class IncrementalParser
+	 * Push interface for input that arrives in pieces, e.g. from a socket or pipe. Every piece is parsed as soon as it is
+	 * fed, so once the last byte arrives only finish() is left to do. Pieces can be split anywhere and are not kept.
+	*/
+	class IncrementalParser {
+		public:
+			explicit IncrementalParser(const ParseOptions& options = {}) : builder_(*document_, options), parser_(builder_, options) {};
+
+			IncrementalParser(const IncrementalParser&) = delete;
+			IncrementalParser& operator= (const IncrementalParser&) = delete;
+
+			void feed(const char* data, const std::size_t length) {
+				if (document_ == nullptr) {
+					QJSON_THROW("Can't feed a parser that already finished");
+				}
+
+				parser_.parse(data, length);
+			};
+
+			void feed(const std::string_view data) { feed(data.data(), data.size()); };
+
+			// checks that the document is complete and hands it over, the parser can not be fed afterwards
+			Json finish() {
+				if (document_ == nullptr) {
+					QJSON_THROW("Parser already finished");
+				}
+
+				parser_.finish();
+				return Json(std::move(document_));
+			};
+
+		private:
+			std::shared_ptr<Document> document_ = std::make_shared<Document>();
+			DomBuilder builder_;
+			Parser<DomBuilder> parser_;
+	};
+
+	/**
+	 * @class NdjsonReader
+	 * Streams newline delimited JSON (JSON Lines): one document per line, blank lines are skipped. The input is read in
+	 * fixed size chunks and every record is parsed as its bytes go by, so memory use does not depend on the size of the
+	 * file. Records share one arena which is reused as long as nothing holds on to the previous record.
+	 *
+	 *     for (const qjson::Json& record : qjson::NdjsonReader("events.ndjson")) { ... }
+	*/
+	class NdjsonReader {
+		public:
+			/**
+			 * @class Iterator
+			 * Input iterator over the records. Advancing it parses the next record.
+			*/
+			class Iterator {
+				public:
+					using iterator_category = std::input_iterator_tag;
+					using value_type = Json;
+					using difference_type = std::ptrdiff_t;
+					using pointer = const Json*;
+					using reference = const Json&;
+
+					explicit Iterator(NdjsonReader* reader) : reader_(reader) {}
+
+					const Json& operator*() const { return *reader_->current_; }
+					const Json* operator->() const { return &*reader_->current_; }
+
+					Iterator& operator++ () {
+						if (!reader_->next()) {
+							reader_ = nullptr;
+						}
+
+						return *this;
+					}
+
+					bool operator== (const Iterator& other) const { return reader_ == other.reader_; }
+					bool operator!= (const Iterator& other) const { return reader_ != other.reader_; }
+
+				private:
+					NdjsonReader* reader_;
+			};
+
+			explicit NdjsonReader(
+				const std::string& filename,
+				const InputMode mode = InputMode::STREAM,
+				const ParseOptions& options = {}
+			) : parser_(builder_, options) {
+				if (mode == InputMode::MMAP && MappedFile::supported) {
+					mapped_file_ = MappedFile(filename);
+					data_ = mapped_file_.data();
+					end_ = data_ + mapped_file_.size();
+				} else {
+					file_.open(filename, std::ios::binary);
+					if (!file_) {
+						QJSON_THROW("Can't open file: " + filename);
+					}
+
+					chunk_.reset(new char[chunk_size_]);
+				}
+			};
+
+			// the buffer is not copied and has to outlive the reader
+			NdjsonReader(const char* data, const std::size_t length, const ParseOptions& options = {})
+				: data_(data),
+				  end_(data + length),
+				  parser_(builder_, options)
+			{};
+
+			NdjsonReader(const NdjsonReader&) = delete;
+			NdjsonReader& operator= (const NdjsonReader&) = delete;
+
+			/**
+			 * Parses the next record. Returns false once the input is exhausted. Handles into the previous record stay
+			 * valid, but while any exist its memory can not be reused. Throws for a record that is not valid JSON, the
+			 * reader is then past its line and calling next() again continues with the following record.
+			*/
+			bool next() {
+				current_.reset();
+				startRecord();
+
+				while (true) {
+					if (data_ == end_ && !refill()) {
+						return !parser_.empty() && finishRecord(line_);
+					}
+
+					const auto* const newline = static_cast<const char*>(std::memchr(data_, '\n', end_ - data_));
+					const char* const line_end = newline == nullptr ? end_ : newline;
+
+					feed(line_end);
+					data_ = line_end;
+
+					if (newline != nullptr) {
+						data_++;
+						line_++;
+
+						if (!parser_.empty()) {
+							return finishRecord(line_ - 1);
+						}
+					}
+				}
+			};
+
+			// the record the last call to next() parsed
+			[[nodiscard]] const Json& current() const {
+				if (!current_) {
+					QJSON_THROW("No current NDJSON record");
+				}
+
+				return *current_;
+			};
+
+			Iterator begin() { return Iterator(next() ? this : nullptr); };
+			Iterator end() { return Iterator(nullptr); };
+
+		private:
+			static constexpr std::size_t chunk_size_ = 64 * 1024;
+
+			// keys kept between records, so records with the same keys keep sharing their shapes
+			static constexpr std::size_t max_recycled_keys_ = 4096;
+
+			MappedFile mapped_file_;
+			std::ifstream file_;
+			std::unique_ptr<char[]> chunk_;
+
+			// unparsed part of the input (or of the current chunk)
+			const char* data_ = nullptr;
+			const char* end_ = nullptr;
+			std::size_t line_ = 1;
+
+			std::shared_ptr<Document> document_ = std::make_shared<Document>();
+			DomBuilder builder_ {*document_};
+			Parser<DomBuilder> parser_ {builder_};
+			std::optional<Json> current_;
+
+			bool refill() {
+				if (chunk_ == nullptr || !file_) {
+					return false;
+				}
+
+				file_.read(chunk_.get(), chunk_size_);
+				data_ = chunk_.get();
+				end_ = data_ + file_.gcount();
+				return data_ != end_;
+			};
+
+			void startRecord() {
+				// reuse the arena unless someone still holds on to the previous record
+				if (document_ != nullptr && document_.use_count() == 1) {
+					document_->arena_.reset();
+					document_->root_ = nullptr;
+
+					// the keys died with the arena, records with ever new keys would otherwise grow the dictionary forever
+					if (document_->keys_->size() > max_recycled_keys_ && document_->keys_.use_count() == 1) {
+						document_->keys_->clear();
+					}
+				} else {
+					document_ = std::make_shared<Document>();
+				}
+
+				builder_.reset(*document_);
+				parser_.reset();
+			};
+
+			void feed(const char* until) {
+				if (!parser_.tryParse(data_, until - data_)) {
+					const std::size_t line = line_;
+					skipLine();
+					QJSON_THROW("NDJSON line " + std::to_string(line) + ": " + parser_.message());
+				}
+			};
+
+			// moves past the next newline, so the line after a broken record can still be read
+			void skipLine() {
+				while (data_ != end_ || refill()) {
+					const auto* const newline = static_cast<const char*>(std::memchr(data_, '\n', end_ - data_));
+					if (newline != nullptr) {
+						data_ = newline + 1;
+						line_++;
+						return;
+					}
+
+					data_ = end_;
+				}
+			};
+
+			bool finishRecord(const std::size_t line) {
+				if (!parser_.tryFinish()) {
+					QJSON_THROW("NDJSON line " + std::to_string(line) + ": " + parser_.message());
+				}
+
+				current_.emplace(Json(document_));
+				return true;
+			};
+	};
+
+	enum struct Delivery {
+		ORDERED,   // records reach the callback in input order
+		UNORDERED  // records of a chunk are handed over as soon as the chunk is parsed
+	};
+
+	/**
+	 * @class ParallelNdjsonReader
+	 * Parses newline delimited JSON on a pool of worker threads. The input is cut into chunks at line boundaries and
+	 * every chunk is parsed independently; the records of one chunk share an arena. The callback always runs on the
+	 * calling thread, so it does not have to be thread safe. Only a bounded number of chunks is in flight at once.
+	 *
+	 *     qjson::ParallelNdjsonReader("events.ndjson").forEach([](const qjson::Json& record) { ... });
+	*/
+	class ParallelNdjsonReader {
+		public:
+			explicit ParallelNdjsonReader(
+				const std::string& filename,
+				const InputMode mode = InputMode::MMAP,
+				const Delivery delivery = Delivery::ORDERED,
+				const unsigned threads = std::thread::hardware_concurrency(),
+				const ParseOptions& options = {}
+			) : delivery_(delivery), threads_(std::max(threads, 1u)), options_(options) {
+				if (mode == InputMode::MMAP && MappedFile::supported) {
+					mapped_file_ = MappedFile(filename);
+					data_ = mapped_file_.data();
+					end_ = data_ + mapped_file_.size();
+				} else {
+					file_.open(filename, std::ios::binary);
+					if (!file_) {
+						QJSON_THROW("Can't open file: " + filename);
+					}
+				}
+			};
+
+			// the buffer is not copied and has to outlive the reader
+			ParallelNdjsonReader(
+				const char* data,
+				const std::size_t length,
+				const Delivery delivery = Delivery::ORDERED,
+				const unsigned threads = std::thread::hardware_concurrency(),
+				const ParseOptions& options = {}
+			) : delivery_(delivery), threads_(std::max(threads, 1u)), options_(options), data_(data), end_(data + length) {};
+
+			ParallelNdjsonReader(const ParallelNdjsonReader&) = delete;
+			ParallelNdjsonReader& operator= (const ParallelNdjsonReader&) = delete;
+
+			/**
+			 * Calls callback(const Json&) for every record. Errors from the workers are rethrown here as
+			 * "NDJSON record at byte N: ...". The input can only be consumed once.
+			*/
+			template <class Callback>
+			void forEach(Callback&& callback) {
+				std::vector<std::thread> workers;
+				workers.reserve(threads_);
+
+				// the workers are stopped however dispatch ends, also when the callback throws
+				struct Stop {
+					ParallelNdjsonReader& reader;
+					std::vector<std::thread>& workers;
+					~Stop() { reader.stop(workers); }
+				} stop_workers {*this, workers};
+
+				for (unsigned i = 0; i < threads_; ++i) {
+					workers.emplace_back([this] { work(); });
+				}
+
+				dispatch(callback);
+			};
+
+		private:
+			static constexpr std::size_t chunk_size_ = 1024 * 1024;
+
+			struct Chunk {
+				std::size_t index;
+				std::size_t offset;  // of the first byte in the whole input, for error messages
+				const char* data;
+				std::size_t length;
+				std::unique_ptr<char[]> buffer;  // owns the bytes when they were read from a stream
+			};
+
+			struct Result {
+				std::vector<Json> records;
+				std::exception_ptr error;
+			};
+
+			Delivery delivery_;
+			unsigned threads_;
+			ParseOptions options_;
+
+			MappedFile mapped_file_;
+			std::ifstream file_;
+			std::string carry_;  // start of a line that did not fit into the previous stream chunk
+
+			// unconsumed part of a mapped or borrowed input
+			const char* data_ = nullptr;
+			const char* end_ = nullptr;
+			std::size_t offset_ = 0;
+			std::size_t chunks_ = 0;
+
+			std::mutex mutex_;
+			std::condition_variable work_ready_;
+			std::condition_variable result_ready_;
+			std::deque<Chunk> work_;
+			std::map<std::size_t, Result> results_;
+			bool stopping_ = false;
+
+			template <class Callback>
+			void dispatch(Callback& callback) {
+				const std::size_t max_in_flight = 2 * static_cast<std::size_t>(threads_);
+				std::size_t in_flight = 0;
+				std::size_t next_delivery = 0;
+				bool exhausted = false;
+
+				while (true) {
+					while (!exhausted && in_flight < max_in_flight) {
+						std::optional<Chunk> chunk = nextChunk();
+						if (!chunk) {
+							exhausted = true;
+							break;
+						}
+
+						{
+							std::lock_guard lock(mutex_);
+							work_.push_back(std::move(*chunk));
+						}
+
+						work_ready_.notify_one();
+						in_flight++;
+					}
+
+					if (in_flight == 0) {
+						return;
+					}
+
+					Result result;
+					{
+						std::unique_lock lock(mutex_);
+						result_ready_.wait(lock, [&] {
+							return delivery_ == Delivery::ORDERED ? results_.contains(next_delivery) : !results_.empty();
+						});
+
+						const auto found = delivery_ == Delivery::ORDERED ? results_.find(next_delivery) : results_.begin();
+						result = std::move(found->second);
+						results_.erase(found);
+					}
+
+					in_flight--;
+					next_delivery++;
+
+					if (result.error) {
+						std::rethrow_exception(result.error);
+					}
+
+					for (const Json& record : result.records) {
+						callback(record);
+					}
+				}
+			};
+
+			// cuts the next chunk off the input, always ending after a newline or at the end of the input
+			std::optional<Chunk> nextChunk() {
+				if (data_ != nullptr) {
+					if (data_ == end_) {
+						return std::nullopt;
+					}
+
+					const char* chunk_end = end_;
+					if (static_cast<std::size_t>(end_ - data_) > chunk_size_) {
+						const auto* const newline = static_cast<const char*>(
+							std::memchr(data_ + chunk_size_, '\n', end_ - data_ - chunk_size_)
+						);
+						chunk_end = newline == nullptr ? end_ : newline + 1;
+					}
+
+					Chunk chunk {chunks_++, offset_, data_, static_cast<std::size_t>(chunk_end - data_), nullptr};
+					offset_ += chunk.length;
+					data_ = chunk_end;
+					return chunk;
+				}
+
+				if (!file_.is_open()) {
+					return std::nullopt;
+				}
+
+				// a stream chunk is whatever was carried over plus the next block, up to its last newline
+				std::unique_ptr<char[]> buffer(new char[carry_.size() + chunk_size_]);
+				std::memcpy(buffer.get(), carry_.data(), carry_.size());
+				file_.read(buffer.get() + carry_.size(), chunk_size_);
+
+				std::size_t length = carry_.size() + static_cast<std::size_t>(file_.gcount());
+				carry_.clear();
+
+				if (!file_) {
+					file_.close();
+				} else {
+					const std::size_t last = std::string_view(buffer.get(), length).rfind('\n');
+					const std::size_t kept = last == std::string_view::npos ? 0 : last + 1;
+					carry_.assign(buffer.get() + kept, length - kept);
+					length = kept;
+				}
+
+				Chunk chunk {chunks_++, offset_, buffer.get(), length, std::move(buffer)};
+				offset_ += length;
+				return chunk;
+			};
+
+			void work() {
+				while (true) {
+					Chunk chunk;
+					{
+						std::unique_lock lock(mutex_);
+						work_ready_.wait(lock, [this] { return stopping_ || !work_.empty(); });
+						if (stopping_) {
+							return;
+						}
+
+						chunk = std::move(work_.front());
+						work_.pop_front();
+					}
+
+					Result result;
+					result.error = captureException([&] { result.records = parseChunk(chunk); });
+
+					{
+						std::lock_guard lock(mutex_);
+						results_.emplace(chunk.index, std::move(result));
+					}
+
+					result_ready_.notify_one();
+				}
+			};
+
+			std::vector<Json> parseChunk(const Chunk& chunk) const {
+				std::vector<Json> records;
+
+				const auto document = std::make_shared<Document>();
+				DomBuilder builder {*document};
+				Parser<DomBuilder> parser {builder, options_};
+
+				const char* data = chunk.data;
+				const char* const end = chunk.data + chunk.length;
+
+				while (data != end) {
+					const auto* const newline = static_cast<const char*>(std::memchr(data, '\n', end - data));
+					const char* const line_end = newline == nullptr ? end : newline;
+
+					builder.reset(*document);
+					parser.reset();
+
+					if (!parser.tryParse(data, line_end - data) || (!parser.empty() && !parser.tryFinish())) {
+						QJSON_THROW(
+							"NDJSON record at byte " + std::to_string(chunk.offset + (data - chunk.data)) + ": " + parser.message()
+						);
+					}
+
+					if (!parser.empty()) {
+						records.push_back(Json(document, document->root_));
+					}
+
+					data = newline == nullptr ? end : newline + 1;
+				}
+
+				return records;
+			};
+
+			void stop(std::vector<std::thread>& workers) {
+				{
+					std::lock_guard lock(mutex_);
+					stopping_ = true;
+				}
+
+				work_ready_.notify_all();
+				for (std::thread& worker : workers) {
+					worker.join();
+				}
+			};
+	};
+
+	/**
+	 * @class TapeValue
+	 * Lightweight view of one value on the tape of a JsonTape. Mirrors the subscript access of json handles, but only
+	 * holds a position on the tape. Containers record where they end, so skipping over a value is O(1). Views are valid
+	 * as long as the JsonTape they came from.
 	*/
-	template <class T> class ov_shared_ptr {
+	class TapeValue {
 		public:
-			ov_shared_ptr() : ptr_(std::make_shared<T>()) {}
-			explicit ov_shared_ptr(JsonType type) : ptr_(std::make_shared<T>()) { ptr_->type_ = type; }
-			explicit ov_shared_ptr(const std::shared_ptr<T>& ptr) : ptr_(ptr) {}
-			ov_shared_ptr(std::nullptr_t ptr) : ptr_(nullptr) {} // NOLINT (explicit)
+			/**
+			 * @class Iterator
+			 * Walks the elements of an array or the values of an object in document order.
+			*/
+			class Iterator {
+				public:
+					Iterator(const TapeValue& container, const std::size_t index)
+						: tape_(container.tape_),
+						  strings_(container.strings_),
+						  index_(index),
+						  object_(container.tag() == '{')
+					{}
 
-			void del(const std::string& key) {
-				if (ptr_ == nullptr) {
-					throw std::runtime_error("Can't delete key on null pointer. Key: " + key);
+					TapeValue operator*() const { return {tape_, strings_, object_ ? index_ + 1 : index_}; }
+
+					Iterator& operator++ () {
+						index_ = TapeValue(tape_, strings_, object_ ? index_ + 1 : index_).skip();
+						return *this;
+					}
+
+					bool operator== (const Iterator& other) const { return index_ == other.index_; }
+					bool operator!= (const Iterator& other) const { return index_ != other.index_; }
+
+					// key of the current member, only valid when iterating over an object
+					[[nodiscard]] std::string_view key() const { return TapeValue(tape_, strings_, index_).asStringView(); }
+
+				private:
+					const std::uint64_t* tape_;
+					const char* strings_;
+					std::size_t index_;
+					bool object_;
+			};
+
+			TapeValue(const std::uint64_t* tape, const char* strings, const std::size_t index)
+				: tape_(tape),
+				  strings_(strings),
+				  index_(index)
+			{}
+
+			static constexpr std::uint64_t payload_mask = (std::uint64_t {1} << 56) - 1;
+			static constexpr std::uint64_t end_mask = 0xFFFFFFFF;
+			static constexpr std::uint64_t max_count = 0xFFFFFF;
+
+			static std::uint64_t word(const char type, const std::uint64_t payload) {
+				return (static_cast<std::uint64_t>(static_cast<unsigned char>(type)) << 56) | payload;
+			}
+
+			[[nodiscard]] JsonType type() const {
+				switch (tag()) {
+					case '{': return JsonType::OBJECT;
+					case '[': return JsonType::ARRAY;
+					case '"': return JsonType::STRING;
+					case 'l': return JsonType::INTEGER;
+					case 'd': return JsonType::DOUBLE;
+					case 't': case 'f': return JsonType::BOOLEAN;
+					case 'n': return JsonType::NULL_VALUE;
+					default: return JsonType::UNINIT;
 				}
+			}
 
-				if (ptr_->type_ != JsonType::OBJECT) {
-					throw std::runtime_error("Can't delete key on non-object. Key: " + key);
+			TapeValue operator[] (const std::string& key) const {
+				if (tag() != '{') {
+					QJSON_THROW("Can't access key on non-object. Key: " + key);
 				}
 
-				if (ptr_->object_data_->find(key) == ptr_->object_data_->end()) {
-					throw std::runtime_error("Key " + key + " not found");
+				for (Iterator member = begin(); member != end(); ++member) {
+					if (member.key() == key) {
+						return *member;
+					}
 				}
 
-				ptr_->object_data_->erase(key);
+				QJSON_THROW("Key " + key + " not found");
 			}
 
-			void del(const int index) {
-				if (ptr_ == nullptr) {
-					throw std::runtime_error("Can't delete index on null pointer. Index: " + std::to_string(index));
+			TapeValue operator[] (const int index) const {
+				if (tag() != '[') {
+					QJSON_THROW("Can't access index on non-array. Index: " + std::to_string(index));
 				}
 
-				if (ptr_->type_ != JsonType::ARRAY) {
-					throw std::runtime_error("Can't delete index on non-array. Index: " + std::to_string(index));
+				if (index >= 0) {
+					int position = 0;
+					for (Iterator element = begin(); element != end(); ++element, ++position) {
+						if (position == index) {
+							return *element;
+						}
+					}
 				}
 
-				if (index < 0 || index >= ptr_->array_data_->size()) {
-					throw std::runtime_error("Index " + std::to_string(index) + " out of bounds");
+				QJSON_THROW("Index " + std::to_string(index) + " out of bounds");
+			}
+
+			[[nodiscard]] Iterator begin() const {
+				if (tag() != '{' && tag() != '[') {
+					QJSON_THROW("Can't iterate over non-object or non-array");
 				}
 
-				if (ptr_->array_data_->size() == 1) {
-					ptr_->array_data_->clear();
-				} else {
-					ptr_->array_data_->erase(ptr_->array_data_->begin() + index);
+				return {*this, index_ + 1};
+			}
+
+			[[nodiscard]] Iterator end() const {
+				if (tag() != '{' && tag() != '[') {
+					QJSON_THROW("Can't iterate over non-object or non-array");
 				}
+
+				return {*this, static_cast<std::size_t>(tape_[index_] & end_mask)};
 			}
 
-			ov_shared_ptr<JsonData> operator[] (const std::string& key) const {
-				if (ptr_ == nullptr) {
-					throw std::runtime_error("Can't access key on null pointer. Key: " + key);
+			// number of elements or members, O(1) unless the container is very large
+			[[nodiscard]] std::size_t size() const {
+				if (tag() != '{' && tag() != '[') {
+					QJSON_THROW("Can't get size of non-object or non-array");
 				}
 
-				if (ptr_->type_ != JsonType::OBJECT) {
-					throw std::runtime_error("Can't access key on non-object. Key: " + key);
+				const std::uint64_t count = (tape_[index_] & payload_mask) >> 32;
+				if (count < max_count) {
+					return count;
 				}
 
-				if (ptr_->object_data_->find(key) == ptr_->object_data_->end()) {
-					throw std::runtime_error("Key " + key + " not found");
+				std::size_t counted = 0;
+				for (Iterator child = begin(); child != end(); ++child) {
+					counted++;
 				}
 
-				return ptr_->object_data_->at(key);
+				return counted;
 			}
 
-			ov_shared_ptr<JsonData> operator[] (const int index) const {
-				if (ptr_ == nullptr) {
-					throw std::runtime_error("Can't access index on null pointer. Index: " + std::to_string(index));
+			[[nodiscard]] std::string_view asStringView() const {
+				if (tag() != '"') {
+					QJSON_THROW("Can not convert non-string type to string");
 				}
 
-				if (ptr_->type_ != JsonType::ARRAY) {
-					throw std::runtime_error("Can't access index on non-array. Index: " + std::to_string(index));
-				}
+				const char* const string = strings_ + (tape_[index_] & payload_mask);
+				std::uint32_t length;
+				std::memcpy(&length, string, sizeof(length));
+				return {string + sizeof(length), length};
+			}
 
-				if (index < 0 || index >= ptr_->array_data_->size()) {
-					throw std::runtime_error("Index " + std::to_string(index) + " out of bounds");
+			[[nodiscard]] std::int64_t asInt() const {
+				if (tag() != 'l') {
+					QJSON_THROW("Can not convert non-integer type to integer");
 				}
 
-				return ptr_->array_data_->at(index);
+				return std::bit_cast<std::int64_t>(tape_[index_ + 1]);
 			}
 
-			T operator*() const {
-				return *ptr_;
-			}
+			[[nodiscard]] double asDouble() const {
+				if (tag() == 'l') {
+					return static_cast<double>(asInt());
+				}
 
-			bool operator== (const ov_shared_ptr<T>& other) const {
-				return ptr_ == other.ptr_;
-			}
+				if (tag() != 'd') {
+					QJSON_THROW("Can not convert non-number type to double");
+				}
 
-			bool operator!= (const ov_shared_ptr<T>& other) const {
-				return ptr_ != other.ptr_;
+				return std::bit_cast<double>(tape_[index_ + 1]);
 			}
 
-			T* operator->() const {
-				return ptr_.get();
+			[[nodiscard]] bool asBool() const {
+				if (tag() != 't' && tag() != 'f') {
+					QJSON_THROW("Can not convert non-boolean type to boolean");
+				}
+
+				return tag() == 't';
 			}
 
-			explicit operator std::string() const {
-				if (ptr_ == nullptr) {
-					throw std::runtime_error("Can not convert null pointer to string");
-				}
+			[[nodiscard]] bool isNull() const { return tag() == 'n'; }
 
-				if (ptr_->type_ != JsonType::STRING) {
-					throw std::runtime_error("Can not convert non-string type to string");
+			[[nodiscard]] std::string toString() const {
+				JsonData scalar;
+				switch (tag()) {
+					case '"': return std::string(asStringView());
+					case 'l': scalar.type_ = JsonType::INTEGER; scalar.integer_data_ = asInt(); break;
+					case 'd': scalar.type_ = JsonType::DOUBLE; scalar.double_data_ = asDouble(); break;
+					case 't': case 'f': scalar.type_ = JsonType::BOOLEAN; scalar.bool_data_ = asBool(); break;
+					case 'n': scalar.type_ = JsonType::NULL_VALUE; break;
+					default: break;
 				}
 
-				return ptr_->string_data_;
+				return scalar.toString();
 			}
 
-			explicit operator T& () { return *ptr_; };
-			explicit operator const T& () const { return *ptr_; }
+			explicit operator std::string() const { return toString(); }
 
-			std::shared_ptr<T> ptr_;
-	};
+		private:
+			const std::uint64_t* tape_;
+			const char* strings_;
+			std::size_t index_;
 
-	inline std::ostream& operator<<(std::ostream &os, const ov_shared_ptr<JsonData>& ptr) {
-		return os << std::string(ptr);
-	}
+			[[nodiscard]] char tag() const { return static_cast<char>(tape_[index_] >> 56); }
 
-	using JsonArray = std::vector<ov_shared_ptr<JsonData>>;
-	using JsonObject = std::unordered_map<std::string, ov_shared_ptr<JsonData>>;
+			// tape index of the value following this one
+			[[nodiscard]] std::size_t skip() const {
+				switch (tag()) {
+					case '{': case '[': return static_cast<std::size_t>(tape_[index_] & end_mask) + 1;
+					case 'l': case 'd': return index_ + 2;
+					default: return index_ + 1;
+				}
+			}
+	};
 
-	using JsonDataPtr = ov_shared_ptr<JsonData>;
-	using json = JsonDataPtr; // shorter alias for user
-	using JsonArrayPtr = ov_shared_ptr<JsonArray>;
-	using JsonObjectPtr = ov_shared_ptr<JsonObject>;
+	inline std::ostream& operator<<(std::ostream &os, const TapeValue& value) {
+		return os << value.toString();
+	}
 
 	/**
-	 * @class JsonData
-	 * JSON tree is built out of these blocks. Each block can be a string, object or array. Allows subscript access.
+	 * @class TapeBuilder
+	 * Parser handler that appends every value to the tape and string buffer of a JsonTape.
 	*/
-	class JsonData {
+	class TapeBuilder {
 		public:
-			std::string key_;
-			JsonType type_ = JsonType::UNINIT;
+			TapeBuilder(std::vector<std::uint64_t>& tape, std::string& strings) : tape_(tape), strings_(strings) {}
 
-			ov_shared_ptr<JsonData> operator[] (const std::string& key) const {
-				if (type_ != JsonType::OBJECT) {
-					throw std::runtime_error("Can't access key on non-object. Key: " + key);
-				}
+			void onStartObject() { open('{'); }
+			void onStartArray() { open('['); }
+			void onEndObject() { close('}'); }
+			void onEndArray() { close(']'); }
 
-				if (object_data_->find(key) == object_data_->end()) {
-					throw std::runtime_error("Key " + key + " not found");
-				}
+			void onKey(const std::string_view key) { appendString(key); }
 
-				return object_data_->at(key);
+			void onString(const std::string_view text) {
+				countValue();
+				appendString(text);
 			}
 
-			ov_shared_ptr<JsonData> operator[] (const int index) const {
-				if (type_ != JsonType::ARRAY) {
-					throw std::runtime_error("Can't access index on non-array. Index: " + std::to_string(index));
-				}
+			void onNumber(const std::int64_t number) {
+				countValue();
+				tape_.push_back(TapeValue::word('l', 0));
+				tape_.push_back(std::bit_cast<std::uint64_t>(number));
+			}
 
-				if (index < 0 || index >= array_data_->size()) {
-					throw std::runtime_error("Index " + std::to_string(index) + " out of bounds");
-				}
+			void onNumber(const double number) {
+				countValue();
+				tape_.push_back(TapeValue::word('d', 0));
+				tape_.push_back(std::bit_cast<std::uint64_t>(number));
+			}
 
-				return array_data_->at(index);
+			void onBool(const bool boolean) {
+				countValue();
+				tape_.push_back(TapeValue::word(boolean ? 't' : 'f', 0));
 			}
 
-			std::string string_data_;
-			ov_shared_ptr<std::unordered_map<std::string, ov_shared_ptr<JsonData>>> object_data_ = nullptr;
-			ov_shared_ptr<std::vector<ov_shared_ptr<JsonData>>> array_data_ = nullptr;
-	};
+			void onNull() {
+				countValue();
+				tape_.push_back(TapeValue::word('n', 0));
+			}
 
-	/**
-	 * @class Json
-	 * Load file in constructor and parse it into a tree structure. Access data with subscript operator.
-	*/
-	class Json {
-		public:
-			explicit Json(const std::string& filename)
-				: file_ {filename},
-				  raw_char_data_ {new char[buffer_size_]}
-			{ parseFile(); };
+		private:
+			std::vector<std::uint64_t>& tape_;
+			std::string& strings_;
 
-			ov_shared_ptr<JsonData> operator[] (const int index) const {
-				if (json_data_.array_data_ == nullptr) {
-					throw std::runtime_error("JSON Parser: Can't access index on non-array");
-				}
+			// tape index of the opening word and element count of every open container
+			std::vector<std::pair<std::size_t, std::uint64_t>> open_;
 
-				if (index < 0 || index >= json_data_.array_data_->size()) {
-					throw std::runtime_error("JSON Parser: Index " + std::to_string(index) + " out of bounds");
+			void countValue() {
+				if (!open_.empty()) {
+					open_.back().second++;
 				}
+			}
 
-				return json_data_.array_data_->at(index);
+			void open(const char c) {
+				countValue();
+				open_.emplace_back(tape_.size(), 0);
+				tape_.push_back(TapeValue::word(c, 0));
 			}
 
-			ov_shared_ptr<JsonData> operator[] (const std::string& key) const {
-				if (json_data_.object_data_ == nullptr) {
-					throw std::runtime_error("JSON Parser: Can't access key on non-object");
+			void close(const char c) {
+				const auto [start, count] = open_.back();
+				open_.pop_back();
+
+				const std::size_t end = tape_.size();
+				if (end > TapeValue::end_mask) {
+					QJSON_THROW("Document too large for tape");
 				}
 
-				if (json_data_.object_data_->find(key) == json_data_.object_data_->end()) {
-					throw std::runtime_error("JSON Parser: Key " + key + " not found");
+				tape_.push_back(TapeValue::word(c, start));
+				tape_[start] = TapeValue::word(c == '}' ? '{' : '[', end | (std::min(count, TapeValue::max_count) << 32));
+			}
+
+			void appendString(const std::string_view text) {
+				if (text.size() > std::numeric_limits<std::uint32_t>::max()) {
+					QJSON_THROW("String too long: " + std::to_string(text.size()) + " bytes");
 				}
 
-				return json_data_.object_data_->at(key);
+				const auto length = static_cast<std::uint32_t>(text.size());
+				tape_.push_back(TapeValue::word('"', strings_.size()));
+				strings_.append(reinterpret_cast<const char*>(&length), sizeof(length));
+				strings_.append(text);
 			}
+	};
+
+	/**
+	 * @class JsonTape
+	 * Alternative to Json that stores the whole parse result as one flat tape of 64 bit words in document order, with
+	 * string contents in a side buffer. Each word holds a type tag in its top byte and a payload below it: containers
+	 * point at their matching end (and store their element count), strings point into the string buffer and numbers
+	 * keep their value in the following word. Scanning a document walks contiguous memory instead of chasing pointers.
+	*/
+	class JsonTape {
+		public:
+			explicit JsonTape(
+				const std::string& filename,
+				const InputMode mode = InputMode::STREAM,
+				const ParseOptions& options = {}
+			) {
+				TapeBuilder builder {begin()};
+				parseFile(filename, builder, mode, options);
+				end();
+			};
+
+			JsonTape(const char* data, const std::size_t length, const ParseOptions& options = {}) {
+				TapeBuilder builder {begin()};
+				parse(data, length, builder, options);
+				end();
+			};
+
+			static JsonTape fromString(const std::string_view text, const ParseOptions& options = {}) {
+				return {text.data(), text.size(), options};
+			};
+
+			[[nodiscard]] TapeValue root() const { return {tape_.data(), strings_.data(), 1}; };
+
+			TapeValue operator[] (const std::string& key) const { return root()[key]; };
+			TapeValue operator[] (const int index) const { return root()[index]; };
 
-			~Json() = default;
 		private:
-			const std::streamsize buffer_size_ = 4096;
+			std::vector<std::uint64_t> tape_;
+			std::string strings_;
 
-			char last_bracket_ = '\0';
-			char last_symbol_ = '\0';
+			// the value is framed by root words, the first one points past the last
+			TapeBuilder begin() {
+				tape_.push_back(TapeValue::word('r', 0));
+				return {tape_, strings_};
+			};
 
-			std::stack<char> brackets_;
-			std::stack<std::string> keys_;
-			std::stack<JsonDataPtr> working_on_;
+			void end() {
+				tape_[0] = TapeValue::word('r', tape_.size());
+				tape_.push_back(TapeValue::word('r', 0));
+			};
+	};
 
-			JsonDataPtr currently_working_on_ = ov_shared_ptr<JsonData>(JsonType::ARRAY);
+	/**
+	 * @class LazyValue
+	 * View of one value inside a LazyJson. Nothing is parsed until it is asked for: subscripts walk the structural index
+	 * of the raw input and skip over members and elements that are not needed by bracket matching, scalars are only
+	 * converted when read. Views are valid as long as the LazyJson they came from.
+	*/
+	class LazyValue {
+		public:
+			LazyValue(
+				const char* data,
+				const std::size_t length,
+				const std::uint32_t* positions,
+				const std::size_t count,
+				const std::size_t index
+			)
+				: data_(data),
+				  length_(length),
+				  positions_(positions),
+				  count_(count),
+				  index_(index)
+			{}
 
-			std::string text_;
+			[[nodiscard]] JsonType type() const {
+				switch (first()) {
+					case '{': return JsonType::OBJECT;
+					case '[': return JsonType::ARRAY;
+					case '"': return JsonType::STRING;
+					default: return scalar().type_;
+				}
+			}
 
-			bool quotes_open = false;
+			LazyValue operator[] (const std::string& key) const {
+				if (first() != '{') {
+					QJSON_THROW("Can't access key on non-object. Key: " + key);
+				}
 
-			bool processing_key_ = true;
-			bool processing_bool_ = false;
-			bool processing_number_ = false;
+				std::size_t member = index_ + 1;
+				if (at(member) == '}') {
+					QJSON_THROW("Key " + key + " not found");
+				}
 
-			std::ifstream file_;
-			std::unique_ptr<char[]> raw_char_data_;
+				while (true) {
+					if (at(member) != '"') {
+						QJSON_THROW("Expected key in object");
+					}
 
-			JsonData json_data_;
+					if (at(member + 2) != ':') {
+						QJSON_THROW("Expected ':' after key");
+					}
 
-			static bool isClosingBracket(const char c) { return c == '}' || c == ']'; };
-			static bool isOpeningBracket(const char c) { return c == '{' || c == '['; };
-			static bool isValidBracket(const char c) { return isOpeningBracket(c) || isClosingBracket(c); };
+					const LazyValue value {data_, length_, positions_, count_, member + 3};
+					if (keyEquals(stringAt(member), key)) {
+						return value;
+					}
 
-			static bool sameBracketType(const char c1, const char c2) {
-				bool c1_square = (c1 == '[') || (c1 == ']');
-				bool c2_square = (c2 == '[') || (c2 == ']');
+					const std::size_t next = value.skip();
+					if (at(next) == '}') {
+						QJSON_THROW("Key " + key + " not found");
+					}
 
-				return c1_square == c2_square;
-			};
+					if (at(next) != ',') {
+						QJSON_THROW("Expected ',' or '}' after member");
+					}
 
-			static bool isNumberPart(const char c) { return (c >= '0' && c <= '9') || c == '.' || c == '-' || c == 'e'; };
+					member = next + 1;
+				}
+			}
 
-			static bool isValidNumber(const std::string& number) {
-				try {
-					std::stod(number);
-				} catch (std::invalid_argument& e) {
-					return false;
+			LazyValue operator[] (const int index) const {
+				if (first() != '[') {
+					QJSON_THROW("Can't access index on non-array. Index: " + std::to_string(index));
 				}
 
-				return true;
-			};
+				std::size_t element = index_ + 1;
+				if (index < 0 || at(element) == ']') {
+					QJSON_THROW("Index " + std::to_string(index) + " out of bounds");
+				}
 
-			static bool isBoolPart(const char c) {
-				return c == 't' || c == 'r' || c == 'u' || c == 'e' || c == 'f' || c == 'a' || c == 'l' || c == 's';
-			};
+				for (int position = 0; position < index; position++) {
+					const std::size_t next = LazyValue(data_, length_, positions_, count_, element).skip();
+					if (at(next) == ']') {
+						QJSON_THROW("Index " + std::to_string(index) + " out of bounds");
+					}
 
-			static bool isValidBool(const std::string& boolean) { return boolean == "true" || boolean == "false"; };
+					if (at(next) != ',') {
+						QJSON_THROW("Expected ',' or ']' after element");
+					}
 
-			bool readBuffer() {
-				if (!file_) return false;
-				file_.read(raw_char_data_.get(), buffer_size_);
-				return true;
-			};
+					element = next + 1;
+				}
 
-			void parseFile() {
-				while (readBuffer()) {
-					std::string buffer {raw_char_data_.get()};
-					parseBuffer(buffer);
-				};
+				return {data_, length_, positions_, count_, element};
+			}
 
-				if (!brackets_.empty()) {
-					throw std::runtime_error("Bracket not closed: " + std::string(1, brackets_.top()));
+			// points into the input, so only strings without escape sequences can be viewed
+			[[nodiscard]] std::string_view asStringView() const {
+				if (first() != '"') {
+					QJSON_THROW("Can not convert non-string type to string");
 				}
 
-				json_data_ = *(currently_working_on_.ptr_->array_data_->at(0));
-			};
+				const std::string_view raw = stringAt(index_);
+				if (raw.find('\\') != std::string_view::npos) {
+					QJSON_THROW("String has escape sequences, use asString()");
+				}
 
-			void parseBuffer(const std::string& buffer) {
-				for (int i = 0; i < file_.gcount(); i++) {
-					const char c = buffer[i];
-					if (c == '"') {
-						if (quotes_open) {
-							quotes_open = false;
-						} else {
-							text_ = "";
-							quotes_open = true;
-						}
-					} else {
-						if (quotes_open) {
-							text_ += c;
-						} else {
-							processJson(c);
-						}
-					}
+				return raw;
+			}
+
+			[[nodiscard]] std::string asString() const {
+				if (first() != '"') {
+					QJSON_THROW("Can not convert non-string type to string");
 				}
-			};
 
-			void processJson(const char c) {
-				// ignore whitespace
-				if (c == ' ' || c == '\n' || c == '\t' || c == '\r') {
-					return;
+				std::string decoded;
+				const std::string_view raw = stringAt(index_);
+				const std::size_t failed = unescapeString(raw, decoded);
+				if (failed != std::string_view::npos) {
+					QJSON_THROW("Invalid escape sequence: " + std::string(escapeAt(raw, failed)));
 				}
 
-				// key value separator
-				if (c == ':') {
-					processing_key_ = false;
-					keys_.push(text_);
-					text_ = "";
+				return decoded;
+			}
+
+			[[nodiscard]] std::int64_t asInt() const { return scalar().asInt(); }
+			[[nodiscard]] double asDouble() const { return scalar().asDouble(); }
+			[[nodiscard]] bool asBool() const { return scalar().asBool(); }
+			[[nodiscard]] bool isNull() const { return first() == 'n' && scalar().isNull(); }
+
+			[[nodiscard]] std::string toString() const {
+				if (first() == '"') {
+					return asString();
 				}
 
-				if (isNumberPart(c) && !processing_bool_) {
-					processing_number_ = true;
-					text_ += c;
+				return scalar().toString();
+			}
+
+			explicit operator std::string() const { return toString(); }
+
+		private:
+			const char* data_;
+			std::size_t length_;
+			const std::uint32_t* positions_;
+			std::size_t count_;
+			std::size_t index_;
+
+			[[nodiscard]] char at(const std::size_t index) const {
+				if (index >= count_) {
+					QJSON_THROW("Unexpected end of input");
 				}
 
-				if (isBoolPart(c) && !processing_number_) {
-					processing_bool_ = true;
-					text_ += c;
+				return data_[positions_[index]];
+			}
+
+			[[nodiscard]] char first() const { return at(index_); }
+
+			// contents of the string whose opening quote is at index, the closing quote is the next position
+			[[nodiscard]] std::string_view stringAt(const std::size_t index) const {
+				const std::uint32_t opening = positions_[index];
+				if (index + 1 >= count_) {
+					QJSON_THROW("Unexpected end of input");
 				}
 
-				if (
-					(c == ',' && !isClosingBracket(last_symbol_)) // comma is only valid after a value
-					|| (isClosingBracket(c) && !text_.empty()) // closing bracket shows end of value
-					|| ((c == ',' || c == '}' || c == ']') && (processing_number_ || processing_bool_)) // number is finished
-				) {
-					if (processing_number_ && !isValidNumber(text_)) {
-						throw std::runtime_error("Invalid number: " + text_);
-					} else if (processing_bool_ && !isValidBool(text_)) {
-						throw std::runtime_error("Invalid boolean: " + text_);
-					}
+				return {data_ + opening + 1, positions_[index + 1] - opening - 1};
+			}
 
-					processing_number_ = false;
-					processing_bool_ = false;
-					if (currently_working_on_->type_ == JsonType::OBJECT) {
-						if (keys_.empty()) {
-							throw std::runtime_error("No key found for value");
-						}
+			static bool keyEquals(const std::string_view raw, const std::string& key) {
+				if (raw.find('\\') == std::string_view::npos) {
+					return raw == key;
+				}
+
+				std::string decoded;
+				const std::size_t failed = unescapeString(raw, decoded);
+				if (failed != std::string_view::npos) {
+					QJSON_THROW("Invalid escape sequence: " + std::string(escapeAt(raw, failed)));
+				}
 
-						std::string key = keys_.top();
-						keys_.pop();
+				return decoded == key;
+			}
 
-						auto text_data = ov_shared_ptr<JsonData>();
-						text_data->type_ = JsonType::STRING;
-						text_data->string_data_ = text_;
+			[[nodiscard]] JsonData scalar() const {
+				const char c = first();
+				if (isStructural(c) || c == '"') {
+					QJSON_THROW("Can not convert non-scalar type");
+				}
 
-						if (currently_working_on_->object_data_ == nullptr) {
-							currently_working_on_->object_data_ = ov_shared_ptr<std::unordered_map<std::string, ov_shared_ptr<JsonData>>>();
-						}
-						currently_working_on_->object_data_->insert({key, text_data});
-					} else if (currently_working_on_->type_ == JsonType::ARRAY) {
-						if (currently_working_on_->array_data_ == nullptr) {
-							currently_working_on_->array_data_ = ov_shared_ptr<std::vector<ov_shared_ptr<JsonData>>>();
-						}
+				const char* const begin = data_ + positions_[index_];
+				const char* end = begin + 1;
+				while (end < data_ + length_ && isScalarPart(*end)) {
+					end++;
+				}
 
-						const auto text_data = ov_shared_ptr<JsonData>();
-						text_data->type_ = JsonType::STRING;
-						text_data->string_data_ = text_;
+				JsonData value;
+				const std::string_view text {begin, static_cast<std::size_t>(end - begin)};
+				if (!parseNumber(text, value) && !parseLiteral(text, value)) {
+					QJSON_THROW("Invalid value: " + std::string(text));
+				}
 
-						if (currently_working_on_->array_data_ == nullptr) {
-							currently_working_on_->array_data_ = ov_shared_ptr<std::vector<ov_shared_ptr<JsonData>>>();
-						}
-						currently_working_on_->array_data_->push_back(text_data);
-					} else {
-						throw std::runtime_error("Can't append value to non-object or non-array");
-					}
+				return value;
+			}
 
-					text_ = "";
+			// index of the position following this value, containers are skipped by matching brackets
+			[[nodiscard]] std::size_t skip() const {
+				const char c = first();
+				if (c == '"') {
+					return index_ + 2;
 				}
 
-				if (isOpeningBracket(c)) {
-					brackets_.push(c);
-					last_bracket_ = c;
+				if (c != '{' && c != '[') {
+					return index_ + 1;
+				}
 
-					if (currently_working_on_ != nullptr) {
-						working_on_.push(currently_working_on_);
+				std::size_t depth = 0;
+				std::size_t index = index_;
+				do {
+					const char current = at(index++);
+					if (current == '{' || current == '[') {
+						depth++;
+					} else if (current == '}' || current == ']') {
+						depth--;
 					}
+				} while (depth != 0);
 
-					currently_working_on_ = ov_shared_ptr<JsonData>();
+				return index;
+			}
+	};
 
-					if (c == '{') {
-						currently_working_on_->type_ = JsonType::OBJECT;
-					} else {
-						currently_working_on_->type_ = JsonType::ARRAY;
-					}
-				} else if (isClosingBracket(c)) {
-					if (brackets_.empty()) {
-						throw std::runtime_error("Closing non existing bracket");
-					}
+	inline std::ostream& operator<<(std::ostream &os, const LazyValue& value) {
+		return os << value.toString();
+	}
 
-					if (!sameBracketType(c, brackets_.top())) {
-						throw std::runtime_error("Bracket type mismatch " + std::string(1, c) + " is closing " + std::string(1, last_bracket_));
+	/**
+	 * @class LazyJson
+	 * On demand front end: only the structural index of the input is built up front. Values are found and converted
+	 * when they are accessed, subtrees that are never touched are skipped without being parsed. Errors in parts of the
+	 * document that are never visited are not reported.
+	 *
+	 * Buffers passed in directly are not copied and must outlive the LazyJson, files are kept open (or read into memory)
+	 * for as long as it exists.
+	*/
+	class LazyJson {
+		public:
+			explicit LazyJson(
+				const std::string& filename,
+				const InputMode mode = InputMode::STREAM,
+				const ParseOptions& options = {}
+			) {
+				if (mode == InputMode::MMAP && MappedFile::supported) {
+					mapped_file_ = MappedFile(filename);
+					index(mapped_file_.data(), mapped_file_.size(), options);
+				} else {
+					std::ifstream file {filename, std::ios::binary};
+					if (!file) {
+						QJSON_THROW("Can't open file: " + filename);
 					}
 
-					brackets_.pop();
-					last_bracket_ = c;
+					contents_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+					index(contents_.data(), contents_.size(), options);
+				}
+			};
 
-					if (working_on_.empty()) {
-						throw std::runtime_error("Can't append value to non-object or non-array");
-					}
+			LazyJson(const char* data, const std::size_t length, const ParseOptions& options = {}) {
+				index(data, length, options);
+			};
 
-					ov_shared_ptr<JsonData> temp = currently_working_on_;
-					currently_working_on_ = working_on_.top();
-					working_on_.pop();
+			static LazyJson fromString(const std::string_view text, const ParseOptions& options = {}) {
+				return {text.data(), text.size(), options};
+			};
 
-					if (currently_working_on_->type_ == JsonType::OBJECT) {
-						if (keys_.empty()) {
-							throw std::runtime_error("No key found for value");
-						}
+			[[nodiscard]] LazyValue root() const { return {data_, length_, positions_.data(), positions_.size(), 0}; };
 
-						std::string key = keys_.top();
-						keys_.pop();
+			LazyValue operator[] (const std::string& key) const { return root()[key]; };
+			LazyValue operator[] (const int index) const { return root()[index]; };
 
-						if (currently_working_on_->object_data_ == nullptr) {
-							currently_working_on_->object_data_ = ov_shared_ptr<std::unordered_map<std::string, ov_shared_ptr<JsonData>>>();
-						}
+		private:
+			MappedFile mapped_file_;
+			std::vector<char> contents_;
+			const char* data_ = nullptr;
+			std::size_t length_ = 0;
+			std::vector<std::uint32_t> positions_;
 
-						currently_working_on_->object_data_->insert({key, temp});
-					} else if (currently_working_on_->type_ == JsonType::ARRAY) {
-						if (currently_working_on_->array_data_ == nullptr) {
-							currently_working_on_->array_data_ = ov_shared_ptr<std::vector<ov_shared_ptr<JsonData>>>();
-						}
+			void index(const char* data, const std::size_t length, const ParseOptions& options) {
+				if (length > std::numeric_limits<std::uint32_t>::max()) {
+					QJSON_THROW("Input too large for on demand parsing: " + std::to_string(length) + " bytes");
+				}
 
-						currently_working_on_->array_data_->push_back(temp);
-					} else {
-						throw std::runtime_error("Can't append value to non-object or non-array");
-					}
+				data_ = data;
+				length_ = length;
+				StructuralIndexer indexer {options};
+				if (!indexer.index(data, length, positions_)) {
+					QJSON_THROW(describe(indexer.error()));
+				}
+
+				if (!indexer.finish()) {
+					QJSON_THROW("Invalid UTF-8: input ends inside a character");
 				}
 
-				last_symbol_ = c;
+				if (positions_.empty()) {
+					QJSON_THROW("No JSON value found");
+				}
 			};
 	};
 };
\ No newline at end of file